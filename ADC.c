@@ -1,26 +1,79 @@
 #include <stdint.h>
 #include "ADC.h"
-#include "tm4c123gh6pm.h"
+#include "TM4C123GH6PM.h"
+#include "os.h"
+#include "Sample_Ring.h"
+#include "Recorder.h"
+#include "Encoder.h"
 
-// how many samples have been taken
-// since the average was taken
-uint8_t sample_count = 0;
+int32_t StartCritical(void);
+void EndCritical(int32_t primask);
 
-// the average voltage at the DC motor
-int32_t average_millivolts = 0;
+// bit-specific address of PC7 (BYTE), writes only change PC7.
+// PC6 is the LCD enable line.
+#define PC7	(GPIO_PORTC_DATA_BITS_R[0x80])
 
-// accumulator variable used for calculating rolling average
-int32_t accum_millivolts = 0;
+// error counters and ISR execution times, read with ADC_GetStats
+ADC_Stats adc_stats;
 
+// time from reading a conversion to processing it in ADC_Process
+CycleStats adc_process_latency = {0xFFFFFFFF, 0, 0, 0};
+
+// raw samples waiting for ADC_Process
+SampleRing adc_ring;
+
+// conversions captured since ADC_Process was last woken
+uint32_t batch_count = 0;
+
+// conversions per wakeup of ADC_Process, ADC_BATCH or control_divider
+// if less, so each release of the control loop is processed at once
+uint32_t adc_batch = ADC_BATCH;
+
+// semaphore signaled to wake ADC_Process
+Sema4Type sSamples;
+
+// conversion rate actually achieved by Timer0A, conversions per second
+uint32_t adc_rate = 0;
+
+// Timer0A period in bus cycles
+uint32_t adc_reload = 0;
+
+// log2 of the CIC decimation ratio actually applied by ADC_SetRate
+uint32_t adc_decimation_shift = 0;
+
+// set by TIMER0A_Handler when it starts a conversion, cleared when
+// GPIOC_Handler reads it
+volatile uint32_t conversion_pending = 0;
+
+// conversions since the control loop was last released
+uint32_t control_count = 0;
+
+// conversions per control loop release, adc_rate / CONTROL_RATE
+uint32_t control_divider = 1;
+
+// control loop releases per second, adc_rate / control_divider. With
+// ADC_PWM_SYNC it is the PWM rate rather than CONTROL_RATE.
+uint32_t control_rate = CONTROL_RATE;
+
+// semaphore signaled to release the control loop
+Sema4Type sControl;
+
+// releases skipped because the control loop had not
+// finished with the previous one
+uint32_t control_deadline_misses = 0;
+
+// CYCLE_COUNT() when the control loop was last released
+uint32_t control_release_time = 0;
+
+// Timer0 must already be clocked, see Init_ADC
 void Timer0A_Init(void){
-  SYSCTL->RCGCTIMER |= 0x01;      // activate timer0
 	TIMER0->CTL &= ~0x00000001;     // disable timer0A during setup
   TIMER0->CFG = 0x00000000;       // configure for timer mode
   TIMER0->TAMR = 0x00000002;      // configure for periodic counting
-  TIMER0->TAILR = 0x00000640;     // start value
+  TIMER0->TAILR = adc_reload - 1; // start value, set by ADC_SetRate
 	TIMER0->ICR = 0x00000004;       // clear timer0A capture match flag
   TIMER0->IMR |= 0x00000001;      // enable timer interrupt
-	NVIC->IP[19] = 2 << 5;
+	NVIC->IP[19] = 1 << 5;          // above OS_KERNEL_PRIORITY and the capture
   NVIC->ISER[0] = 1 << 19;              // enable interrupt 19 in NVIC
 	TIMER0->CTL |= 0x00000001;      // timer0A 24-b, +edge, interrupts
   __enable_irq();
@@ -32,7 +85,8 @@ void Init_ADC() {
 	// 	DB3 - DB0 => PB5 - PB2
 	// 	R/C  => PC4
 	//	BUSY => PC5
-	//  BYTE => Constant low (selects MSB from ADC)
+	//  BYTE => PC7 when ADC_12BIT is set (low selects MSB, high selects LSB),
+	//          otherwise constant low (MSB only)
 	
 	// Initialize data pins PE5 - PE2 as digital inputs
 	SYSCTL_RCGCGPIO_R |= 0x10;
@@ -60,8 +114,17 @@ void Init_ADC() {
 	GPIO_PORTC_DIR_R &= ~(0x20);
 	GPIO_PORTC_DEN_R |=  (0x20);
 		
+#if ADC_12BIT
+	// PC7 is used for the BYTE select output to the ADC
+	GPIO_PORTC_DIR_R |= 0x80;
+	GPIO_PORTC_DEN_R |= 0x80;
+#endif
+		
 	// default control signals
 	GPIO_PORTC_DATA_R |= 0x10; // set RC signal high
+#if ADC_12BIT
+	PC7 = 0; // select MSB
+#endif
 	
 	/* configure PORTC5 for rising edge trigger interrupt */
 	GPIO_PORTC_IS_R  &= ~(0x20);        /* make bit 5, 0 edge sensitive */
@@ -71,12 +134,27 @@ void Init_ADC() {
 	GPIO_PORTC_PUR_R &= ~(0x20);					/* enable pull-up resistor for PC5 */
 	GPIO_PORTC_IM_R  |=  (0x20);          /* unmask interrupt */
 	
-	/* enable interrupt in NVIC and set priority to 3 */
-	NVIC->IP[2] = 3 << 5;     /* set interrupt priority to 3 */
+	/* enable interrupt in NVIC and set priority to 2, above OS_KERNEL_PRIORITY */
+	NVIC->IP[2] = 2 << 5;     /* set interrupt priority to 2 */
 	NVIC->ISER[0] |= (1<<2);  /* enable IRQ01 (D02 of ISER[0]) */
 	
+	SampleRing_Init(&adc_ring);
+	Sample_Process_Init(ADC_DEFAULT_RATE);
+	ADC_ResetStats();
+	SystemCoreClockUpdate();
+	
+#if ADC_PWM_SYNC
+	// PWM1_3_Handler starts the conversions, Timer0A stays off
+	ADC_SetRate(ADC_DEFAULT_RATE, FILTER_CIC_SHIFT);
+#else
+	// activate timer0 before ADC_SetRate writes its reload
+	SYSCTL_RCGCTIMER_R |= 0x01;
+	while ((SYSCTL_PRTIMER_R & 0x01) == 0) {};
+	ADC_SetRate(ADC_DEFAULT_RATE, FILTER_CIC_SHIFT);
+	
 	// initialize timer
 	Timer0A_Init();
+#endif
 }
 
 void Toggle_ADC_RC() {
@@ -91,17 +169,37 @@ uint8_t Read_ADC_BUSY() {
 	return GPIO_PORTC_DATA_R & 0x20;
 }
 
-uint8_t Read_Data_Bits() {
+// reads DB7 - DB0 from the ADC
+static uint8_t Read_Data_Byte() {
 	uint8_t retVal;
 	
-	uint32_t temp = GPIO_PORTE_DATA_R;
-	uint32_t temp2 = GPIO_PORTB_DATA_R;
 	retVal =  (GPIO_PORTE_DATA_R & (0x20 + 0x10 + 0x08 + 0x04)) << 2;
 	retVal |= (GPIO_PORTB_DATA_R & (0x20 + 0x10 + 0x08 + 0x04)) >> 2;
 	
 	return retVal;
 }
 
+// Returns the conversion result. With ADC_12BIT the MSB and LSB bytes
+// are read in turn and the full word is in the 12 LSBs, otherwise
+// only the MSB byte is read and returned in the 8 LSBs.
+uint16_t Read_Data_Bits() {
+#if ADC_12BIT
+	uint16_t retVal;
+	
+	// BYTE is low: DB7 - DB0 hold D11 - D4
+	retVal = Read_Data_Byte() << 4;
+	
+	// BYTE high: DB7 - DB4 hold D3 - D0
+	PC7 = 0x80;
+	retVal |= Read_Data_Byte() >> 4;
+	PC7 = 0; // back to MSB for the next conversion
+	
+	return retVal;
+#else
+	return Read_Data_Byte();
+#endif
+}
+
 void Start_Sample_ADC() {	
 	// start conversion
 	GPIO_PORTC_DATA_R &= ~0x10;
@@ -114,60 +212,194 @@ void Start_Sample_ADC() {
 int32_t Retrieve_Sample_ADC() {
 	int32_t retVal;
 		
+#if ADC_12BIT
+	retVal = Read_Data_Bits() & 0xFFF;
+#else
 	// get MSB byte from conversion
 	retVal = (Read_Data_Bits() & 0xFF) << 4;
+#endif
 	
 	return retVal;
 }
 
-// Assumes that the input signal to the ADC is between +10V and -10V,
-// returns the voltage of the sample in millivolts
-int32_t Sample_to_Millivolts(int32_t sample) {
-	int32_t retVal;
-	int32_t temp;
-	uint32_t scale_constant = 205; // 205 sample ticks = 1 V
-	
-	if (sample & 0x00000800) {
-		// sample is negative in two's complement, copy sign bit over
-		temp = 0 - (sample);
-	} else {
-		// sample is positive in two's complement, copy sign bit over
-		temp = sample;  
+// Starts a conversion from a trigger ISR. If the previous conversion
+// was never read by GPIOC_Handler it is counted as missed.
+static void ADC_Trigger(void) {
+	if (conversion_pending) {
+		++adc_stats.missed_conversions;
+		adc_stats.last_missed_time = CYCLE_COUNT();
 	}
+	conversion_pending = 1;
 	
-	// project sample range onto signal's voltage range
-	retVal = (1000 * temp) / scale_constant; // millivolts
-	
-	return retVal;
+	// start next sample
+	Start_Sample_ADC();
 }
 
+// Runs above OS_KERNEL_PRIORITY, so the OS never delays it, and above
+// GPIOC_Handler, so nothing it shares with the capture changes under it.
 void TIMER0A_Handler(void) {
-	DisableInterrupts();
-	// start next sample
-	Start_Sample_ADC();
+	uint32_t start = CYCLE_COUNT();
+	// cycles since the timeout, the timer counts down from TAILR
+	CycleStats_Put(&adc_stats.trigger_latency, TIMER0->TAILR - TIMER0->TAV);
+	ADC_Trigger();
 	
 	TIMER0_ICR_R = 0x01; // acknowledge timer0A periodic
-	EnableInterrupts();
+	CycleStats_Add(&adc_stats.trigger_isr, start);
 }
 
+#if ADC_PWM_SYNC
+// Starts a conversion at the same point of every PWM period, so the
+// samples do not alias with the PWM waveform
+void PWM1_3_Handler(void) {
+	uint32_t start = CYCLE_COUNT();
+	ADC_Trigger();
+	
+	PWM1->_3_ISC = 0x20; // acknowledge comparator B down
+	CycleStats_Add(&adc_stats.trigger_isr, start);
+}
+#endif
+
+// Captures the raw conversion into adc_ring and wakes ADC_Process once
+// every adc_batch conversions. Conversion and filtering are done there.
+// Runs above OS_KERNEL_PRIORITY, so the wakeup goes through
+// OS_SignalDeferred.
 void GPIOC_Handler(void) {
-	DisableInterrupts();
+	uint32_t start = CYCLE_COUNT();
+	int32_t sample;
 	if (GPIOC->MIS & 0x20) {  
 		if (Read_ADC_BUSY() != 0) {
 			// sample is ready
-			accum_millivolts += Sample_to_Millivolts(Retrieve_Sample_ADC());
-			++sample_count;
+			conversion_pending = 0;
+			++adc_stats.conversions;
+			sample = Retrieve_Sample_ADC();
+			if (SampleRing_Put(&adc_ring, sample, start) != 0) {
+				adc_stats.last_overrun_time = start;
+			}
+#if RECORDER
+			else {
+				// only samples ADC_Process will see, so the replay stays in step
+				Recorder_Put(REC_SAMPLE, sample);
+			}
+#endif
+			
+			if (++batch_count >= adc_batch) {
+				batch_count = 0;
+				if (sSamples.Value <= 0) {
+					OS_SignalDeferred(&sSamples); // otherwise it is already awake
+				}
+			}
+		} else {
+			// edge seen but BUSY is low again, a new conversion has started
+			++adc_stats.busy_not_ready;
+			adc_stats.last_busy_time = start;
+		}
+		GPIOC->ICR = 0x20; /* clear the interrupt flag */
+	}
+	CycleStats_Add(&adc_stats.capture_isr, start);
+}
+
+// ******** ADC_GetStats ************
+// copies the ADC error counters and ISR timing without tearing
+// input:  where to store the statistics
+// output: none
+void ADC_GetStats(ADC_Stats *stats) {
+	int32_t status = StartCritical();
+	*stats = adc_stats;
+	stats->ring_overruns = adc_ring.overruns;
+	EndCritical(status);
+}
+
+// ******** ADC_ResetStats ************
+// clears the ADC error counters and ISR timing
+// input:  none
+// output: none
+void ADC_ResetStats(void) {
+	int32_t status = StartCritical();
+	adc_stats.conversions = 0;
+	adc_stats.missed_conversions = 0;
+	adc_stats.last_missed_time = 0;
+	adc_stats.busy_not_ready = 0;
+	adc_stats.last_busy_time = 0;
+	adc_stats.ring_overruns = 0;
+	adc_stats.last_overrun_time = 0;
+	adc_ring.overruns = 0;
+	CycleStats_Reset(&adc_stats.trigger_isr);
+	CycleStats_Reset(&adc_stats.trigger_latency);
+	CycleStats_Reset(&adc_stats.capture_isr);
+	EndCritical(status);
+}
+
+// ******** ADC_SetRate ************
+// changes the conversion rate and the CIC decimation ratio. Timer0A,
+// the control loop divider and the biquad coefficients are recomputed
+// from SystemCoreClock so the control rate and filter cutoff stay put.
+// input:  conversions per second (ADC_MIN_RATE to ADC_MAX_RATE),
+//         log2 of the decimation ratio, limited to what the CIC
+//         registers hold and left in adc_decimation_shift
+// output: achieved conversion rate
+uint32_t ADC_SetRate(uint32_t rate, uint32_t decimation_shift) {
+	int32_t status;
+	uint32_t reload;
+	
+	status = StartCritical();
+#if ADC_PWM_SYNC
+	// one conversion per PWM period, the rate argument is ignored
+	(void)rate;
+	(void)reload;
+	adc_reload = 0;
+	adc_rate = PWM_CLOCK / pwm_period;
+#else
+	if (rate > ADC_MAX_RATE) rate = ADC_MAX_RATE;
+	if (rate < ADC_MIN_RATE) rate = ADC_MIN_RATE;
+	reload = SystemCoreClock / rate;
+	adc_reload = reload;
+	adc_rate = SystemCoreClock / reload;
+	TIMER0->TAILR = reload - 1; // takes effect at the next timeout
+#endif
+	
+	control_divider = adc_rate / CONTROL_RATE;
+	if (control_divider == 0) {
+		control_divider = 1;
+	}
+	control_rate = adc_rate / control_divider;
+	adc_batch = (control_divider < ADC_BATCH) ? control_divider : ADC_BATCH;
+#if SPEED_ENCODER
+	Encoder_SetRate(control_rate);
+#endif
+	
+	adc_decimation_shift = Sample_Process_SetRate(adc_rate, decimation_shift);
+#if RECORDER
+	Recorder_Rate(adc_rate, adc_decimation_shift);
+#endif
+	EndCritical(status);
+	
+	return adc_rate;
+}
+
+// ******** ADC_Process ************
+// thread that drains adc_ring, passes the samples to Sample_Process
+// for filtering and the moving average, and releases the control loop every
+// control_divider conversions
+void ADC_Process(void) {
+	ADC_Sample s;
+	
+	for (;;) {
+		OS_Wait(&sSamples);
+		while (SampleRing_Get(&adc_ring, &s)) {
+			CycleStats_Add(&adc_process_latency, s.time);
+			
+			Sample_Process(s.sample, pwm_duty);
 			
-			if (sample_count >= NUM_SAMPLES) {
-				// enough samples taken, calculate new average voltage
-				average_millivolts = accum_millivolts / NUM_SAMPLES;
-				
-				// reset accumulator variables
-				accum_millivolts = 0;
-				sample_count = 0;
+			if (++control_count >= control_divider) {
+				// release the control loop
+				control_count = 0;
+				if (sControl.Value > 0) {
+					++control_deadline_misses;
+				} else {
+					control_release_time = CYCLE_COUNT();
+					OS_Signal(&sControl);
+				}
 			}
 		}
-		GPIOC->ICR |= 0x20; /* clear the interrupt flag */
 	}
-	EnableInterrupts();
-}
\ No newline at end of file
+}
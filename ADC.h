@@ -1,15 +1,57 @@
 #include <stdint.h>
+#include "TM4C123GH6PM.h"
 #include "tm4c123gh6pm_def.h"
 
-extern uint8_t sample_count;
-extern int32_t average_millivolts;
-extern int32_t accum_millivolts;
+#include "Cycle_Count.h"
+#include "Sample_Ring.h"
+#include "PWM.h"
+#include "Sample_Process.h"
+#include "os.h"
 
-#define NUM_SAMPLES	100
+// Errors and ISR execution times on the conversion path. The time
+// fields are the CYCLE_COUNT() of the most recent event.
+typedef struct {
+	uint32_t conversions;         // samples read by GPIOC_Handler
+	uint32_t missed_conversions;  // conversion started before the last one was read
+	uint32_t last_missed_time;
+	uint32_t busy_not_ready;      // GPIOC interrupt with BUSY low
+	uint32_t last_busy_time;
+	uint32_t ring_overruns;       // samples dropped because adc_ring was full
+	uint32_t last_overrun_time;
+	CycleStats trigger_isr;       // TIMER0A_Handler or PWM1_3_Handler
+	CycleStats trigger_latency;   // Timer0A timeout until TIMER0A_Handler runs
+	CycleStats capture_isr;       // GPIOC_Handler
+} ADC_Stats;
+
+extern CycleStats adc_process_latency;
+extern SampleRing adc_ring;
+
+// GPIOC_Handler wakes ADC_Process once every ADC_BATCH conversions, or
+// every control_divider conversions if that is less
+#define ADC_BATCH	10
+
+// conversions per second, changed at run time with ADC_SetRate
+#define ADC_DEFAULT_RATE	10000
+#define ADC_MIN_RATE	500
+#define ADC_MAX_RATE	50000
+extern uint32_t adc_rate;
+extern uint32_t adc_decimation_shift;
+
+// the control loop is released about CONTROL_RATE times per second,
+// once every control_divider conversions, control_rate times exactly
+#define CONTROL_RATE	1000
+extern uint32_t control_divider;
+extern uint32_t control_rate;
+extern Sema4Type sControl;
+extern uint32_t control_deadline_misses;
+extern uint32_t control_release_time;
 
 void Init_ADC();
 void Toggle_ADC_RC();
 uint8_t Read_ADC_BUSY();
-uint8_t Read_Data_Bits();
+uint16_t Read_Data_Bits();
 int32_t Sample_ADC();
-int32_t Sample_to_Millivolts(int32_t sample);
\ No newline at end of file
+void ADC_GetStats(ADC_Stats *stats);
+void ADC_ResetStats(void);
+uint32_t ADC_SetRate(uint32_t rate, uint32_t decimation_shift);
+void ADC_Process(void);
\ No newline at end of file
@@ -0,0 +1,37 @@
+// Cycle_Count.c
+// Runs on TM4C123
+// Execution time measurement using the Cortex-M4 DWT cycle counter.
+
+#include <stdint.h>
+#include "Cycle_Count.h"
+
+// ******** CycleCount_Init ************
+// enables the trace unit and starts the DWT cycle counter
+// input:  none
+// output: none
+void CycleCount_Init(void) {
+	CoreDebug->DEMCR |= CoreDebug_DEMCR_TRCENA_Msk; // enable DWT
+	DWT->CYCCNT = 0;
+	DWT->CTRL |= DWT_CTRL_CYCCNTENA_Msk;            // start counting
+}
+
+// ******** CycleStats_Reset ************
+// clears a set of statistics
+// input:  statistics to clear
+// output: none
+void CycleStats_Reset(CycleStats *stats) {
+	stats->min = 0xFFFFFFFF;
+	stats->max = 0;
+	stats->count = 0;
+	stats->total = 0;
+}
+
+// ******** CycleStats_Average ************
+// input:  statistics to average
+// output: mean cycles per measurement, 0 if nothing measured
+uint32_t CycleStats_Average(CycleStats *stats) {
+	if (stats->count == 0) {
+		return 0;
+	}
+	return (uint32_t)(stats->total / stats->count);
+}
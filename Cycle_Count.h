@@ -0,0 +1,43 @@
+// Cycle_Count.h
+// Runs on TM4C123
+// Execution time measurement using the Cortex-M4 DWT cycle counter.
+// One count is one 62.5 ns bus cycle at 16 MHz.
+
+#ifndef CYCLE_COUNT_H
+#define CYCLE_COUNT_H
+
+#include <stdint.h>
+#include "TM4C123GH6PM.h"
+
+// running min/max/average of a measured code section
+typedef struct {
+	uint32_t min;    // fewest cycles seen
+	uint32_t max;    // most cycles seen
+	uint32_t count;  // number of measurements
+	uint64_t total;  // sum of all measurements, for the average
+} CycleStats;
+
+// current value of the free-running cycle counter
+#define CYCLE_COUNT()	(DWT->CYCCNT)
+
+void CycleCount_Init(void);
+void CycleStats_Reset(CycleStats *stats);
+uint32_t CycleStats_Average(CycleStats *stats);
+
+// ******** CycleStats_Put ************
+// adds one measurement of a number of cycles
+static __inline void CycleStats_Put(CycleStats *stats, uint32_t cycles) {
+	if (cycles < stats->min) stats->min = cycles;
+	if (cycles > stats->max) stats->max = cycles;
+	stats->count++;
+	stats->total += cycles;
+}
+
+// ******** CycleStats_Add ************
+// adds one measurement, given the CYCLE_COUNT() taken at the start
+// of the measured section. Cheap enough to call from an ISR.
+static __inline void CycleStats_Add(CycleStats *stats, uint32_t start) {
+	CycleStats_Put(stats, CYCLE_COUNT() - start); // wraps correctly
+}
+
+#endif
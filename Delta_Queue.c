@@ -0,0 +1,110 @@
+// Delta_Queue.c
+// Runs on TM4C123, or on a host for benchmarking
+// Sorted delta queue of timeouts. The callers disable interrupts.
+
+#include <stdint.h>
+#include "Delta_Queue.h"
+
+// ******** DeltaQueue_Init ************
+// input:  queue
+// output: none
+void DeltaQueue_Init(DeltaQueue *q) {
+	q->head = 0;
+}
+
+// ******** DeltaQueue_Insert ************
+// adds an entry that expires after the given number of ticks, behind
+// any entries expiring on the same tick. Walks the entries that expire
+// first.
+// input:  queue, entry not in any queue, ticks (at least 1)
+// output: none
+void DeltaQueue_Insert(DeltaQueue *q, DQ_Node *n, uint32_t ticks) {
+	DQ_Node *prev = 0;
+	DQ_Node *pt = q->head;
+
+	while (pt && pt->delta <= ticks) {
+		ticks -= pt->delta;
+		prev = pt;
+		pt = pt->next;
+	}
+
+	n->delta = ticks;
+	n->prev = prev;
+	n->next = pt;
+	if (pt) {
+		pt->delta -= ticks;  // now relative to n
+		pt->prev = n;
+	}
+	if (prev) {
+		prev->next = n;
+	} else {
+		q->head = n;
+	}
+}
+
+// ******** DeltaQueue_Remove ************
+// takes an entry out before it expires
+// input:  queue, entry in the queue
+// output: none
+void DeltaQueue_Remove(DeltaQueue *q, DQ_Node *n) {
+	if (n->next) {
+		n->next->delta += n->delta;
+		n->next->prev = n->prev;
+	}
+	if (n->prev) {
+		n->prev->next = n->next;
+	} else {
+		q->head = n->next;
+	}
+	n->next = 0;
+	n->prev = 0;
+}
+
+// ******** DeltaQueue_Tick ************
+// counts one tick off the head. Call DeltaQueue_Expired afterwards
+// until it returns 0.
+// input:  queue
+// output: none
+void DeltaQueue_Tick(DeltaQueue *q) {
+	if (q->head && q->head->delta) {
+		q->head->delta--;
+	}
+}
+
+// ******** DeltaQueue_Advance ************
+// counts a number of ticks off the queue, for a tickless caller that
+// advances it by the time elapsed since the last call. Every entry this
+// expires is left with delta 0 for DeltaQueue_Expired to take off.
+// input:  queue, ticks
+// output: none
+void DeltaQueue_Advance(DeltaQueue *q, uint32_t ticks) {
+	DQ_Node *pt = q->head;
+
+	while (pt && ticks) {
+		if (pt->delta > ticks) {
+			pt->delta -= ticks;
+			return;
+		}
+		ticks -= pt->delta;
+		pt->delta = 0;
+		pt = pt->next;
+	}
+}
+
+// ******** DeltaQueue_Expired ************
+// removes the head if it has expired
+// input:  queue
+// output: expired entry, 0 if none
+DQ_Node *DeltaQueue_Expired(DeltaQueue *q) {
+	DQ_Node *n = q->head;
+
+	if (n == 0 || n->delta) {
+		return 0;
+	}
+	q->head = n->next;
+	if (q->head) {
+		q->head->prev = 0;
+	}
+	n->next = 0;
+	return n;
+}
@@ -0,0 +1,32 @@
+// Delta_Queue.h
+// Runs on TM4C123, or on a host for benchmarking
+// Queue of timeouts sorted by expiry, each entry holding only the ticks
+// after the one before it. A tick decrements the head alone and expired
+// entries come off the front, so the cost of a tick does not grow with
+// the number of waiting entries. Used by the OS for OS_Sleep, with
+// ticks of the OS_Time clock.
+
+#ifndef DELTA_QUEUE_H
+#define DELTA_QUEUE_H
+
+#include <stdint.h>
+
+// embedded in whatever is waiting, e.g. a thread control block
+typedef struct DQ_Node {
+	struct DQ_Node *next;
+	struct DQ_Node *prev;
+	uint32_t delta;  // ticks after the previous entry expires
+} DQ_Node;
+
+typedef struct {
+	DQ_Node *head;   // expires first, 0 if empty
+} DeltaQueue;
+
+void DeltaQueue_Init(DeltaQueue *q);
+void DeltaQueue_Insert(DeltaQueue *q, DQ_Node *n, uint32_t ticks);
+void DeltaQueue_Remove(DeltaQueue *q, DQ_Node *n);
+void DeltaQueue_Tick(DeltaQueue *q);
+void DeltaQueue_Advance(DeltaQueue *q, uint32_t ticks);
+DQ_Node *DeltaQueue_Expired(DeltaQueue *q);
+
+#endif
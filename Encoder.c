@@ -0,0 +1,111 @@
+// Encoder.c
+// Runs on TM4C123
+// Motor speed from a quadrature encoder on QEI0 (PhA0 = PD6, PhB0 = PD7).
+// At high speed the QEI velocity capture counts edges over a fixed
+// window. At low speed that count is too coarse, so the edges are counted
+// from the position register over a longer window that slides by one
+// control period at a time. The QEI cannot time single edges, and timing
+// a few edges in whole control periods biased the estimate upwards.
+
+#include <stdint.h>
+#include "Encoder.h"
+#include "TM4C123GH6PM.h"
+#include "tm4c123gh6pm_def.h"
+
+// control loop releases per second
+uint32_t encoder_rate;
+
+// 1 while counting from the position register, 0 while using the
+// velocity capture
+uint32_t encoder_slow_mode = 1;
+
+// positions at the last ENCODER_MAX_TICKS control periods, the next one
+// to write, and how many are valid
+uint32_t encoder_history[ENCODER_MAX_TICKS];
+uint32_t encoder_history_index;
+uint32_t encoder_history_count;
+
+// control periods in the low-speed window, ENCODER_SLOW_MS at encoder_rate
+uint32_t encoder_window_ticks;
+
+// last speed estimate in RPM
+int32_t encoder_rpm = 0;
+
+// ******** Encoder_Init ************
+// sets up PD6/PD7 as PhA0/PhB0 and QEI0 in x4 mode with velocity capture
+// input:  control loop releases per second
+// output: none
+void Encoder_Init(uint32_t control_rate) {
+	Encoder_SetRate(control_rate);
+
+	SYSCTL_RCGCQEI_R |= 0x01;         // clock QEI0
+	SYSCTL_RCGCGPIO_R |= 0x08;        // clock Port D
+	while ((SYSCTL_PRGPIO_R & 0x08) == 0) {};
+
+	GPIO_PORTD_LOCK_R = GPIO_LOCK_KEY; // PD7 is locked (NMI)
+	GPIO_PORTD_CR_R |= 0x80;
+	GPIO_PORTD_DIR_R &= ~0xC0;
+	GPIO_PORTD_AFSEL_R |= 0xC0;
+	GPIO_PORTD_PCTL_R = (GPIO_PORTD_PCTL_R & 0x00FFFFFF) | 0x66000000; // PhA0, PhB0
+	GPIO_PORTD_DEN_R |= 0xC0;
+
+	while ((SYSCTL_PRQEI_R & 0x01) == 0) {};
+	QEI0_CTL_R = 0;                   // disable during setup
+	QEI0_MAXPOS_R = 0xFFFFFFFF;       // position wraps like a uint32_t
+	QEI0_LOAD_R = SystemCoreClock / ENCODER_VEL_RATE - 1;
+	QEI0_POS_R = 0;
+	QEI0_CTL_R = QEI_CTL_CAPMODE      // count edges of both phases
+	           | QEI_CTL_VELEN        // capture velocity
+	           | QEI_CTL_FILTEN       // filter the inputs
+	           | QEI_CTL_ENABLE;
+}
+
+// ******** Encoder_SetRate ************
+// changes the control loop release rate, called by ADC_SetRate
+// input:  control loop releases per second
+// output: none
+void Encoder_SetRate(uint32_t control_rate) {
+	encoder_rate = control_rate;
+	encoder_window_ticks = (control_rate * ENCODER_SLOW_MS) / 1000;
+	if (encoder_window_ticks == 0) {
+		encoder_window_ticks = 1;
+	} else if (encoder_window_ticks > ENCODER_MAX_TICKS) {
+		encoder_window_ticks = ENCODER_MAX_TICKS;
+	}
+	encoder_history_count = 0; // the positions so far were taken at the old rate
+}
+
+// ******** Encoder_Speed ************
+// must be called once per control period
+// input:  none
+// output: motor speed in RPM
+int32_t Encoder_Speed(void) {
+	uint32_t pos = QEI0_POS_R;
+	uint32_t edges = QEI0_SPEED_R;    // edges in the last velocity window
+	uint32_t ticks = encoder_history_count;
+
+	// switch with hysteresis so the estimate does not chatter
+	if (encoder_slow_mode && edges >= 2 * ENCODER_SWITCH_EDGES) {
+		encoder_slow_mode = 0;
+	} else if (!encoder_slow_mode && edges < ENCODER_SWITCH_EDGES) {
+		encoder_slow_mode = 1;
+	}
+
+	// the window is kept up in both modes, so it is full on a switch
+	if (ticks > encoder_window_ticks) {
+		ticks = encoder_window_ticks;
+	}
+	if (encoder_slow_mode && ticks > 0) {
+		uint32_t old = encoder_history[(encoder_history_index + ENCODER_MAX_TICKS - ticks) % ENCODER_MAX_TICKS];
+		encoder_rpm = ((pos - old) * 60 * encoder_rate) / (ENCODER_CPR * ticks);
+	} else if (!encoder_slow_mode) {
+		encoder_rpm = (edges * 60 * ENCODER_VEL_RATE) / ENCODER_CPR;
+	}
+
+	encoder_history[encoder_history_index] = pos;
+	encoder_history_index = (encoder_history_index + 1) % ENCODER_MAX_TICKS;
+	if (encoder_history_count < ENCODER_MAX_TICKS) {
+		++encoder_history_count;
+	}
+	return encoder_rpm;
+}
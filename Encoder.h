@@ -0,0 +1,32 @@
+// Encoder.h
+// Runs on TM4C123
+// Motor speed from a quadrature encoder on QEI0 (PhA0 = PD6, PhB0 = PD7).
+// The QEI counts the edges in hardware, so there are no per-edge
+// interrupts. Encoder_Speed is called once per control loop release.
+
+#ifndef ENCODER_H
+#define ENCODER_H
+
+#include <stdint.h>
+
+// 1 feeds the encoder speed to the controller instead of the
+// voltage-based speed
+#ifndef SPEED_ENCODER
+#define SPEED_ENCODER	0
+#endif
+
+#define ENCODER_CPR	400      // counted edges per revolution (100 lines x 4)
+#define ENCODER_VEL_RATE	100  // QEI velocity windows per second
+
+// Below ENCODER_SWITCH_EDGES edges per velocity window the edges are
+// counted from the position register instead, over the last
+// ENCODER_SLOW_MS, which is at most ENCODER_MAX_TICKS control periods
+#define ENCODER_SWITCH_EDGES	32
+#define ENCODER_SLOW_MS	20
+#define ENCODER_MAX_TICKS	100
+
+void Encoder_Init(uint32_t control_rate);
+void Encoder_SetRate(uint32_t control_rate);
+int32_t Encoder_Speed(void);
+
+#endif
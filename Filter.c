@@ -0,0 +1,178 @@
+// Filter.c
+// Runs on TM4C123, or on a host for benchmarking
+// Fixed-point filters for the motor voltage stream. On the Cortex-M4 the
+// FIR inner loop uses SMLAD to do two 16-bit multiply-accumulates per
+// instruction; elsewhere the same arithmetic is done one tap at a time.
+
+#include <stdint.h>
+#include <string.h>
+#include "Filter.h"
+#if FILTER_USE_DSP
+#include "TM4C123GH6PM.h"
+#endif
+
+// saturates to the 16-bit range of the FIR delay line
+static int16_t Filter_Sat16(int32_t x) {
+	if (x > 32767) return 32767;
+	if (x < -32768) return -32768;
+	return (int16_t)x;
+}
+
+// ******** FIR_Init ************
+// input:  filter, Q15 coefficients (oldest sample first), number of taps (even)
+// output: none
+void FIR_Init(FIR_Filter *f, const int16_t *coeffs, uint32_t taps) {
+	f->coeffs = coeffs;
+	f->taps = taps;
+	f->pos = 0;
+	memset(f->history, 0, sizeof(f->history));
+}
+
+// ******** FIR_Step ************
+// The sum of |coeffs| must stay below 1.0 for full-scale 16-bit inputs;
+// millivolt inputs (under 10000) leave about 3x headroom.
+// input:  filter, new sample, where to store the output
+// output: 1, an FIR has an output for every input
+int FIR_Step(FIR_Filter *f, int32_t in, int32_t *out) {
+	int16_t x = Filter_Sat16(in);
+	const int16_t *h;
+	int32_t acc = 0;
+	uint32_t i;
+
+	f->history[f->pos] = x;
+	f->history[f->pos + f->taps] = x;
+	if (++f->pos >= f->taps) {
+		f->pos = 0;
+	}
+	h = &f->history[f->pos]; // oldest of the newest taps samples
+
+#if FILTER_USE_DSP
+	for (i = 0; i < f->taps; i += 2) {
+		uint32_t xs, cs;
+		memcpy(&xs, &h[i], 4);          // h may be only halfword aligned
+		memcpy(&cs, &f->coeffs[i], 4);
+		acc = __SMLAD(xs, cs, acc);     // acc += h[i]*c[i] + h[i+1]*c[i+1]
+	}
+#else
+	for (i = 0; i < f->taps; i++) {
+		acc += h[i] * f->coeffs[i];
+	}
+#endif
+
+	*out = acc >> 15;
+	return 1;
+}
+
+// ******** Biquad_Init ************
+// input:  filter, Q14 coefficients of
+//         y = b0*x + b1*x1 + b2*x2 - a1*y1 - a2*y2
+// output: none
+void Biquad_Init(Biquad_Filter *f, int16_t b0, int16_t b1, int16_t b2, int16_t a1, int16_t a2) {
+	f->b0 = b0;
+	f->b1 = b1;
+	f->b2 = b2;
+	f->a1 = a1;
+	f->a2 = a2;
+	f->x1 = f->x2 = 0;
+	f->y1 = f->y2 = 0;
+}
+
+// ******** Biquad_Step ************
+// input:  filter, new sample, where to store the output
+// output: 1, a biquad has an output for every input
+int Biquad_Step(Biquad_Filter *f, int32_t in, int32_t *out) {
+	int64_t acc;
+	int32_t y;
+
+	acc  = (int64_t)f->b0 * in;
+	acc += (int64_t)f->b1 * f->x1;
+	acc += (int64_t)f->b2 * f->x2;
+	acc -= (int64_t)f->a1 * f->y1;
+	acc -= (int64_t)f->a2 * f->y2;
+	y = (int32_t)(acc >> 14);
+
+	f->x2 = f->x1;
+	f->x1 = in;
+	f->y2 = f->y1;
+	f->y1 = y;
+
+	*out = y;
+	return 1;
+}
+
+// ******** Median_Init ************
+// input:  filter, window length (odd, at most MEDIAN_MAX_N)
+// output: none
+void Median_Init(Median_Filter *f, uint32_t n) {
+	f->n = n;
+	f->pos = 0;
+	memset(f->window, 0, sizeof(f->window));
+}
+
+// ******** Median_Step ************
+// rejects single-sample spikes by returning the median of the window
+// input:  filter, new sample, where to store the output
+// output: 1, there is an output for every input
+int Median_Step(Median_Filter *f, int32_t in, int32_t *out) {
+	int32_t sorted[MEDIAN_MAX_N];
+	uint32_t i, j;
+
+	f->window[f->pos] = in;
+	if (++f->pos >= f->n) {
+		f->pos = 0;
+	}
+
+	// insertion sort, n is small
+	for (i = 0; i < f->n; i++) {
+		int32_t v = f->window[i];
+		for (j = i; j > 0 && sorted[j - 1] > v; j--) {
+			sorted[j] = sorted[j - 1];
+		}
+		sorted[j] = v;
+	}
+
+	*out = sorted[f->n / 2];
+	return 1;
+}
+
+// ******** CIC_Init ************
+// input:  filter, order (1 to CIC_MAX_ORDER), log2 of the decimation ratio
+// output: log2 of the decimation ratio applied, at most CIC_MAX_SHIFT(order)
+uint32_t CIC_Init(CIC_Filter *f, uint32_t order, uint32_t shift) {
+	if (shift > CIC_MAX_SHIFT(order)) {
+		shift = CIC_MAX_SHIFT(order);
+	}
+	f->order = order;
+	f->shift = shift;
+	f->phase = 0;
+	memset(f->integ, 0, sizeof(f->integ));
+	memset(f->comb, 0, sizeof(f->comb));
+	return shift;
+}
+
+// ******** CIC_Step ************
+// input:  filter, new sample, where to store the output
+// output: 1 once every 1 << shift inputs when *out is written, else 0
+int CIC_Step(CIC_Filter *f, int32_t in, int32_t *out) {
+	uint32_t v = (uint32_t)in;
+	uint32_t k;
+
+	for (k = 0; k < f->order; k++) {
+		f->integ[k] += v;
+		v = f->integ[k];
+	}
+
+	if (++f->phase < (1u << f->shift)) {
+		return 0;
+	}
+	f->phase = 0;
+
+	for (k = 0; k < f->order; k++) {
+		uint32_t prev = f->comb[k];
+		f->comb[k] = v;
+		v -= prev;
+	}
+
+	*out = (int32_t)v >> (f->order * f->shift); // remove the DC gain of R^order
+	return 1;
+}
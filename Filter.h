@@ -0,0 +1,71 @@
+// Filter.h
+// Runs on TM4C123, or on a host for benchmarking
+// Fixed-point filters for the motor voltage stream: FIR, biquad IIR,
+// median-of-N and CIC decimation. Each stage takes one input sample and
+// returns 1 when it has an output, so stages can be chained.
+
+#ifndef FILTER_H
+#define FILTER_H
+
+#include <stdint.h>
+
+// use the Cortex-M4 dual 16-bit multiply-accumulate (SMLAD) when available
+#if defined(__ARM_FEATURE_DSP) || defined(__TARGET_FEATURE_DSPMUL)
+#define FILTER_USE_DSP	1
+#else
+#define FILTER_USE_DSP	0
+#endif
+
+#define FIR_MAX_TAPS	32  // must be even
+#define MEDIAN_MAX_N	7
+#define CIC_MAX_ORDER	4
+
+// FIR with Q15 coefficients. The delay line is stored twice so the
+// newest FIR taps samples are always contiguous.
+typedef struct {
+	const int16_t *coeffs;           // taps entries, oldest sample's coefficient first
+	uint32_t taps;                   // even, at most FIR_MAX_TAPS
+	uint32_t pos;                    // next slot to write
+	int16_t history[2 * FIR_MAX_TAPS];
+} FIR_Filter;
+
+// second order section, direct form I, Q14 coefficients (a0 = 1)
+typedef struct {
+	int16_t b0, b1, b2, a1, a2;
+	int32_t x1, x2, y1, y2;
+} Biquad_Filter;
+
+// median of the last n samples, n odd
+typedef struct {
+	uint32_t n;
+	uint32_t pos;
+	int32_t window[MEDIAN_MAX_N];
+} Median_Filter;
+
+// CIC decimator with differential delay 1. The decimation ratio is
+// 1 << shift, and the output is scaled back to the input range. The
+// register growth order * shift plus the input width must fit in 32 bits,
+// so CIC_Init limits the shift to CIC_MAX_SHIFT(order).
+#define CIC_INPUT_BITS	16  // signed inputs, e.g. millivolts within +/-32 V
+#define CIC_MAX_SHIFT(order)	((32 - CIC_INPUT_BITS) / (order))
+typedef struct {
+	uint32_t order;                  // number of integrator/comb pairs
+	uint32_t shift;                  // log2 of the decimation ratio
+	uint32_t phase;                  // inputs since the last output
+	uint32_t integ[CIC_MAX_ORDER];   // wrap around by design
+	uint32_t comb[CIC_MAX_ORDER];
+} CIC_Filter;
+
+void FIR_Init(FIR_Filter *f, const int16_t *coeffs, uint32_t taps);
+int FIR_Step(FIR_Filter *f, int32_t in, int32_t *out);
+
+void Biquad_Init(Biquad_Filter *f, int16_t b0, int16_t b1, int16_t b2, int16_t a1, int16_t a2);
+int Biquad_Step(Biquad_Filter *f, int32_t in, int32_t *out);
+
+void Median_Init(Median_Filter *f, uint32_t n);
+int Median_Step(Median_Filter *f, int32_t in, int32_t *out);
+
+uint32_t CIC_Init(CIC_Filter *f, uint32_t order, uint32_t shift);
+int CIC_Step(CIC_Filter *f, int32_t in, int32_t *out);
+
+#endif
@@ -1,3 +1,4 @@
 #include <stdint.h>
+#include "os.h"
 
-int32_t sLCD;
\ No newline at end of file
+extern MutexType sLCD;
\ No newline at end of file
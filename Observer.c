@@ -0,0 +1,54 @@
+// Observer.c
+// Runs on TM4C123
+// Steady-state Kalman (fixed gain) observer of the DC motor speed.
+// Runs once per ADC sample, so the estimate follows duty changes
+// immediately instead of waiting for the moving average to fill.
+
+#include <stdint.h>
+#include "Observer.h"
+
+// ******** Observer_Init ************
+// input:  observer, ADC samples per second
+// output: none
+void Observer_Init(Observer_Type *obs, uint32_t rate) {
+	obs->rpm = 0;
+	obs->l = OBSERVER_L;
+	Observer_SetRate(obs, rate);
+}
+
+// ******** Observer_SetRate ************
+// recomputes the model discretization for a new sample rate.
+// 1 - a = 1 - exp(-T/tau) is close to T/tau since tau is many samples.
+// input:  observer, ADC samples per second
+// output: none
+void Observer_SetRate(Observer_Type *obs, uint32_t rate) {
+	uint32_t samples_per_tau = (rate * OBSERVER_TAU_MS) / 1000;
+
+	if (samples_per_tau == 0) {
+		samples_per_tau = 1;
+	}
+	obs->alpha = 65536 / samples_per_tau;
+}
+
+// ******** Observer_Update ************
+// predicts one sample ahead from the commanded duty, then corrects with
+// the measurement
+// input:  observer, PWM duty count, speed from one ADC sample (RPM)
+// output: none
+void Observer_Update(Observer_Type *obs, int32_t duty, int32_t meas_rpm) {
+	int32_t target = (int32_t)(((int64_t)OBSERVER_GAIN * duty) + ((int64_t)OBSERVER_OFFSET * 65536));
+	int32_t predict;
+
+	if (target < 0) {
+		target = 0; // the motor does not turn backwards
+	}
+	predict = obs->rpm + (int32_t)(((int64_t)obs->alpha * (target - obs->rpm)) >> 16);
+	obs->rpm = predict + (int32_t)(((int64_t)obs->l * ((meas_rpm << 16) - predict)) >> 16);
+}
+
+// ******** Observer_Speed ************
+// input:  observer
+// output: estimated speed in RPM
+int32_t Observer_Speed(Observer_Type *obs) {
+	return obs->rpm >> 16;
+}
@@ -0,0 +1,39 @@
+// Observer.h
+// Runs on TM4C123
+// Steady-state Kalman (fixed gain) observer of the DC motor speed.
+// The motor is modeled as a first-order lag from PWM duty to RPM:
+//   rpm[k+1] = rpm[k] + (1 - a) * (OBSERVER_GAIN * duty + OBSERVER_OFFSET - rpm[k])
+// and each ADC sample, converted to RPM, corrects the prediction.
+
+#ifndef OBSERVER_H
+#define OBSERVER_H
+
+#include <stdint.h>
+
+// 1 feeds the observer estimate to the controller instead of the
+// averaged voltage
+#ifndef SPEED_OBSERVER
+#define SPEED_OBSERVER	0
+#endif
+
+// motor model, nominal values to be refined from a duty step on the bench
+#define OBSERVER_TAU_MS	100      // mechanical time constant
+#define OBSERVER_GAIN	63570    // steady-state RPM per duty count, Q16.16 (0.97)
+#define OBSERVER_OFFSET	(-170)   // steady-state RPM at zero duty
+
+// correction gain per sample, Q16.16. Larger trusts the samples more;
+// 0.01 suits the 8-bit samples at 10 kHz.
+#define OBSERVER_L	655
+
+typedef struct {
+	int32_t rpm;     // estimate, Q16.16 RPM
+	int32_t alpha;   // 1 - a, Q16.16, depends on the sample rate
+	int32_t l;       // correction gain, Q16.16
+} Observer_Type;
+
+void Observer_Init(Observer_Type *obs, uint32_t rate);
+void Observer_SetRate(Observer_Type *obs, uint32_t rate);
+void Observer_Update(Observer_Type *obs, int32_t duty, int32_t meas_rpm);
+int32_t Observer_Speed(Observer_Type *obs);
+
+#endif
@@ -0,0 +1,94 @@
+// PID.c
+// Runs on TM4C123
+// Fixed-point PID controller for the DC motor speed loop.
+// Integer only, so no soft-float library calls in the control loop.
+// The integral is kept in output units, so changing gains while the
+// motor is running does not make the duty cycle jump.
+
+#include <stdint.h>
+#include "PID.h"
+
+// clamps a Q16.16 value to the output limits
+static int64_t PID_Clamp(PID_Type *pid, int64_t valQ16) {
+	if (valQ16 > ((int64_t)pid->outMax * PID_ONE)) return (int64_t)pid->outMax * PID_ONE;
+	if (valQ16 < ((int64_t)pid->outMin * PID_ONE)) return (int64_t)pid->outMin * PID_ONE;
+	return valQ16;
+}
+
+// ******** PID_Init ************
+// sets gains and output limits and clears the controller state
+// input:  controller, Q16.16 gains, derivative filter coefficient,
+//         output limits (duty cycle counts)
+// output: none
+void PID_Init(PID_Type *pid, int32_t kP, int32_t kI, int32_t kD,
+              int32_t dAlpha, int32_t outMin, int32_t outMax) {
+	pid->kP = kP;
+	pid->kI = kI;
+	pid->kD = kD;
+	pid->dAlpha = dAlpha;
+	pid->outMin = outMin;
+	pid->outMax = outMax;
+	PID_Reset(pid, 0);
+}
+
+// ******** PID_SetGains ************
+// changes gains without a bump in the output. The integral absorbs
+// the change in the proportional and derivative terms.
+// input:  controller, new Q16.16 gains
+// output: none
+void PID_SetGains(PID_Type *pid, int32_t kP, int32_t kI, int32_t kD) {
+	int64_t integral = pid->integral;
+
+	integral += (int64_t)(pid->kP - kP) * pid->prevError;
+	integral += ((int64_t)(pid->kD - kD) * pid->dFilt) >> 16;
+	pid->integral = (int32_t)PID_Clamp(pid, integral);
+
+	pid->kP = kP;
+	pid->kI = kI;
+	pid->kD = kD;
+}
+
+// ******** PID_Reset ************
+// clears the integral and derivative state, e.g. when the motor is stopped
+// input:  controller, current measurement
+// output: none
+void PID_Reset(PID_Type *pid, int32_t meas) {
+	pid->integral = 0;
+	pid->dFilt = 0;
+	pid->prevMeas = meas;
+	pid->prevError = 0;
+}
+
+// ******** PID_Update ************
+// runs one controller iteration. The derivative acts on the measurement
+// so setpoint steps do not kick the output. Integration stops while the
+// output is saturated in the direction of the error (anti-windup).
+// input:  controller, setpoint and measurement (RPM), feedforward (duty counts)
+// output: new duty cycle, within outMin..outMax
+int32_t PID_Update(PID_Type *pid, int32_t setpoint, int32_t meas, int32_t feedforward) {
+	int32_t error = setpoint - meas;
+	int64_t p, d, out;
+	int32_t dRaw;
+
+	// proportional
+	p = (int64_t)pid->kP * error;
+
+	// filtered derivative of the measurement
+	dRaw = (pid->prevMeas - meas) * PID_ONE;
+	pid->dFilt += (int32_t)(((int64_t)pid->dAlpha * (dRaw - pid->dFilt)) >> 16);
+	d = ((int64_t)pid->kD * pid->dFilt) >> 16;
+	pid->prevMeas = meas;
+	pid->prevError = error;
+
+	out = p + pid->integral + d + ((int64_t)feedforward * PID_ONE);
+
+	// conditional integration
+	if (!((out >= ((int64_t)pid->outMax * PID_ONE) && error > 0) ||
+	      (out <= ((int64_t)pid->outMin * PID_ONE) && error < 0))) {
+		int64_t integral = pid->integral + (int64_t)pid->kI * error;
+		pid->integral = (int32_t)PID_Clamp(pid, integral);
+		out = p + pid->integral + d + ((int64_t)feedforward * PID_ONE);
+	}
+
+	return (int32_t)(PID_Clamp(pid, out) >> 16);
+}
@@ -0,0 +1,35 @@
+// PID.h
+// Runs on TM4C123
+// Fixed-point PID controller for the DC motor speed loop.
+// All gains are Q16.16: 1.0 is 0x00010000 (PID_ONE).
+
+#ifndef PID_H
+#define PID_H
+
+#include <stdint.h>
+
+#define PID_ONE	65536  // 1.0 in Q16.16
+
+// converts a constant such as 0.75 to Q16.16 at compile time
+#define PID_Q16(x)	((int32_t)((x) * PID_ONE))
+
+typedef struct {
+	int32_t kP;        // proportional gain, Q16.16
+	int32_t kI;        // integral gain per update, Q16.16
+	int32_t kD;        // derivative gain, Q16.16
+	int32_t dAlpha;    // derivative low-pass coefficient, Q16.16 (PID_ONE = no filtering)
+	int32_t integral;  // integral term in output units, Q16.16
+	int32_t dFilt;     // filtered derivative of the measurement, Q16.16
+	int32_t prevMeas;  // measurement from the previous update
+	int32_t prevError; // error from the previous update
+	int32_t outMin;    // output lower limit
+	int32_t outMax;    // output upper limit
+} PID_Type;
+
+void PID_Init(PID_Type *pid, int32_t kP, int32_t kI, int32_t kD,
+              int32_t dAlpha, int32_t outMin, int32_t outMax);
+void PID_SetGains(PID_Type *pid, int32_t kP, int32_t kI, int32_t kD);
+void PID_Reset(PID_Type *pid, int32_t meas);
+int32_t PID_Update(PID_Type *pid, int32_t setpoint, int32_t meas, int32_t feedforward);
+
+#endif
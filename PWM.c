@@ -1,10 +1,41 @@
 #include "TM4C123GH6PM.h"
 #include "tm4c123gh6pm_def.h"
 #include "delay.h"
+#include "PWM.h"
+
+// PWM period in PWM clock counts
+uint16_t pwm_period;
+
+// duty cycle last set, in PWM clock counts
+uint16_t pwm_duty;
 
 void OS_DisableInterrupts(void); // Disable interrupts
 void OS_EnableInterrupts(void);  // Enable interrupts
 
+#if ADC_PWM_SYNC
+// Counter value at which the ADC conversion is started, for a duty in
+// PWM clock counts. The generator counts down from LOAD: the output is
+// low from LOAD to CMPA and high from CMPA to zero. The result stays in
+// 0..LOAD-1 so comparator B is crossed every period, and with the motor
+// off, when there is no phase to follow, it is the middle of the period.
+static uint16_t PWM_Sync_Compare(uint16_t duty) {
+	uint32_t load = pwm_period - 1;
+	uint32_t cmpb;
+	if (duty == 0) {
+		return (uint16_t)(load / 2);
+	}
+#if PWM_SYNC_PHASE == PWM_SYNC_ON_TIME
+	cmpb = (uint32_t)(duty - 1) / 2;
+#else
+	cmpb = (load + duty - 1) / 2;
+#endif
+	if (cmpb > load - 1) {
+		cmpb = load - 1;
+	}
+	return (uint16_t)cmpb;
+}
+#endif
+
 void MOT12_Dir_Set_Forward(void) {
 	GPIOB->DATA &= ~0x01;
 	GPIOB->DATA |= 0x02;
@@ -35,6 +66,15 @@ void MOT12_Init(uint16_t period, uint16_t duty)
     PWM1->_3_GENA = 0x000000C8;   // output low for load, high for match
     PWM1->_3_LOAD = period-1;       // 2499
     PWM1->_3_CMPA = duty-1;         // percent*(loadvalue+1)-1
+    pwm_period = period;
+    pwm_duty = duty;
+#if ADC_PWM_SYNC
+    PWM1->_3_CMPB = PWM_Sync_Compare(duty); // ADC trigger point
+    PWM1->_3_INTEN = 0x20;          // interrupt on comparator B going down
+    PWM1->INTEN |= 0x08;            // generator 3 interrupts to the NVIC
+    NVIC->IP[137] = 1 << 5;         // same priority as Timer0A
+    NVIC->ISER[4] = 1 << (137 - 128); // enable IRQ 137
+#endif
     PWM1->_3_CTL = 1;               // enable PWM1_3
     PWM1->ENABLE |= 0x40;           // enable PWM1
 	
@@ -55,6 +95,10 @@ void MOT12_Init(uint16_t period, uint16_t duty)
 void MOT12_Speed_Set(uint16_t duty)
 {
     PWM1->_3_CMPA = duty-1;
+    pwm_duty = duty;
+#if ADC_PWM_SYNC
+    PWM1->_3_CMPB = PWM_Sync_Compare(duty); // keep the sampling phase
+#endif
 }
 
 
@@ -63,7 +107,7 @@ void PWM_setup(void){
 	uint16_t period = 2500; // 250KHz/100Hz -1 = 2500
 	
 	// required to keep a minimum duty cycle
-	uint16_t minmum_duty = 450; //18% of 2500
+	uint16_t minimum_duty = 450; //18% of 2500
 	
 	//initalization
 	MOT12_Init(period,minimum_duty);
@@ -1,4 +1,29 @@
-#include "TM4C123GH6PM.h"
+#ifndef PWM_H
+#define PWM_H
+
+#include <stdint.h>
+
+// PWM1 runs from the 16 MHz system clock divided by 64
+#define PWM_CLOCK	250000
+
+// With ADC_PWM_SYNC the ADC conversions are started by PWM1 generator 3
+// once per PWM period at a fixed phase, instead of by Timer0A
+#ifndef ADC_PWM_SYNC
+#define ADC_PWM_SYNC	0
+#endif
+
+// phase of the synchronized conversion
+#define PWM_SYNC_ON_TIME	0   // middle of the on-time, motor driven
+#define PWM_SYNC_OFF_TIME	1   // middle of the off-time, back-EMF only
+#ifndef PWM_SYNC_PHASE
+#define PWM_SYNC_PHASE	PWM_SYNC_OFF_TIME
+#endif
+
+extern uint16_t pwm_period;
+extern uint16_t pwm_duty;
+
 void MOT12_Init(uint16_t period, uint16_t duty);
 void PWM_setup(void);
-void MOT12_Speed_Set(uint16_t duty);
\ No newline at end of file
+void MOT12_Speed_Set(uint16_t duty);
+
+#endif
@@ -0,0 +1,25 @@
+// RPM_Table.h
+// Breakpoints of the motor voltage to RPM map used by Current_speed.
+// Entry i is the speed at i << RPM_TABLE_SHIFT millivolts.
+// Generated by tools/rpm_fit.c; this default samples the original
+// linear fit ((21408*mV)>>16)-225, and keeps its 1200 mV cutoff.
+
+#ifndef RPM_TABLE_H
+#define RPM_TABLE_H
+
+#include <stdint.h>
+
+#define RPM_TABLE_SHIFT	8   // 256 mV between breakpoints
+#define RPM_TABLE_SIZE	41  // covers 0 - 10240 mV
+#define RPM_CUTOFF_MV	1200  // below this the motor is taken as stopped
+
+static const int32_t RPM_Table[RPM_TABLE_SIZE] = {
+	   0,    0,    0,   25,  109,  193,  276,  360,
+	 444,  527,  611,  694,  778,  862,  945, 1029,
+	1113, 1196, 1280, 1363, 1447, 1531, 1614, 1698,
+	1782, 1865, 1949, 2032, 2116, 2200, 2283, 2367,
+	2451, 2534, 2618, 2701, 2785, 2869, 2952, 3036,
+	3120
+};
+
+#endif
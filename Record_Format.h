@@ -0,0 +1,31 @@
+// Record_Format.h
+// Runs on TM4C123, or on a host for replaying recordings
+// Format of the stream written by Recorder.c and read by tools/replay.c.
+//
+// Stream format, little-endian 32-bit words:
+//   bits 31-28  type, REC_...
+//   bits 27-16  12-bit value
+//   bits 15-0   cycles since the previous record
+// REC_START and REC_RATE use bits 15-0 as data and do not advance the
+// time. REC_GAP advances the time by value * 65536 cycles in addition
+// to its own 16-bit field, for pauses longer than 4 ms.
+
+#ifndef RECORD_FORMAT_H
+#define RECORD_FORMAT_H
+
+#define RECORDER_MAGIC	0x5243  // data of REC_START, "RC"
+#define RECORDER_VERSION	1   // value of REC_START
+
+// record types
+#define REC_START	0   // stream start, value is RECORDER_VERSION
+#define REC_RATE	1   // data is adc_rate, value is the CIC decimation shift
+#define REC_GAP	2   // value is extra time in units of 65536 cycles
+#define REC_DROP	3   // value is records lost because the buffer was full
+#define REC_SAMPLE	4   // raw sample from Retrieve_Sample_ADC, not if adc_ring overran
+#define REC_KEY	5   // Key_ASCII
+#define REC_SETPOINT	6   // des_rpm used from now on by the controller
+#define REC_CONTROL	7   // processed_samples & 0xFFF when the controller ran
+#define REC_SPEED	8   // cur_rpm used by the controller
+#define REC_DUTY	9   // N set by the controller
+
+#endif
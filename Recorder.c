@@ -0,0 +1,185 @@
+// Recorder.c
+// Runs on TM4C123
+// Records the speed loop into a word buffer that the UART0 transmit
+// interrupt streams out on PA1 (U0Tx). Recorder_Put may be called from
+// threads and from GPIOC_Handler. It always takes the same few steps
+// and drops the record when the buffer is full, so its cost in the ISR
+// is bounded; recorder_stats.put measures it.
+
+#include <stdint.h>
+#include "Recorder.h"
+#include "TM4C123GH6PM.h"
+#include "tm4c123gh6pm_def.h"
+
+int32_t StartCritical(void);
+void EndCritical(int32_t primask);
+
+// counters and Recorder_Put execution time
+Recorder_Stats recorder_stats;
+
+// records waiting for the UART
+uint32_t recorder_buf[RECORDER_SIZE];
+volatile uint32_t recorder_put = 0;  // written only by Recorder_Put
+volatile uint32_t recorder_get = 0;  // written only by UART0_Handler
+
+// CYCLE_COUNT() of the last timed record in the buffer
+uint32_t recorder_last_time;
+
+// records dropped since the last REC_DROP
+uint32_t recorder_drops = 0;
+
+// word being sent by UART0_Handler and how many of its bytes are left
+uint32_t recorder_tx_word;
+uint32_t recorder_tx_bytes = 0;
+
+// 1 when UART0_Handler has run out of records, the next record
+// restarts it
+uint32_t recorder_tx_idle = 1;
+
+// ******** Recorder_Add ************
+// puts one record in the buffer and restarts the UART if it is idle.
+// Called with interrupts disabled.
+// input:  time, type, value, time field data for untimed records
+// output: none
+static void Recorder_Add(uint32_t now, uint32_t type, int32_t value, uint32_t data, int timed) {
+	uint32_t count = recorder_put - recorder_get;
+	uint32_t dt = now - recorder_last_time;
+	uint32_t need = 1;
+
+	if (value < 0) value = 0;
+	if (value > 0xFFF) value = 0xFFF;
+	if (timed && dt > 0xFFFF) ++need;
+	if (recorder_drops) ++need;
+
+	if (count + need > RECORDER_SIZE) {
+		++recorder_drops;
+		++recorder_stats.dropped;
+		return;
+	}
+
+	if (recorder_drops) {
+		recorder_buf[recorder_put++ & (RECORDER_SIZE - 1)] =
+			(REC_DROP << 28) | ((recorder_drops > 0xFFF ? 0xFFF : recorder_drops) << 16);
+		recorder_drops = 0;
+	}
+	if (timed) {
+		if (dt > 0xFFFF) {
+			recorder_buf[recorder_put++ & (RECORDER_SIZE - 1)] =
+				(REC_GAP << 28) | (((dt >> 16) > 0xFFF ? 0xFFF : (dt >> 16)) << 16);
+		}
+		data = dt & 0xFFFF;
+		recorder_last_time = now;
+	}
+	recorder_buf[recorder_put++ & (RECORDER_SIZE - 1)] = (type << 28) | ((uint32_t)value << 16) | data;
+
+	recorder_stats.records += need;
+	count += need;
+	if (count > recorder_stats.high_water) {
+		recorder_stats.high_water = count;
+	}
+	if (recorder_tx_idle) {
+		recorder_tx_idle = 0;
+		NVIC->ISPR[0] = 1 << 5; // pend UART0_Handler
+	}
+}
+
+// ******** Recorder_Init ************
+// sets up UART0 at RECORDER_BAUD and starts the stream
+// input:  current PWM duty
+// output: none
+void Recorder_Init(uint32_t duty) {
+	uint32_t divider;
+	int32_t status;
+
+	SYSCTL_RCGCUART_R |= 0x01;         // clock UART0
+	SYSCTL_RCGCGPIO_R |= 0x01;         // clock Port A
+	while ((SYSCTL_PRGPIO_R & 0x01) == 0) {};
+
+	GPIO_PORTA_AFSEL_R |= 0x02;        // PA1 is U0Tx
+	GPIO_PORTA_PCTL_R = (GPIO_PORTA_PCTL_R & 0xFFFFFF0F) | 0x00000010;
+	GPIO_PORTA_AMSEL_R &= ~0x02;
+	GPIO_PORTA_DEN_R |= 0x02;
+
+	while ((SYSCTL_PRUART_R & 0x01) == 0) {};
+	UART0_CTL_R = 0;                   // disable during setup
+	SystemCoreClockUpdate();
+	// baud divisor SystemCoreClock / (16 * RECORDER_BAUD) in 64ths
+	divider = (SystemCoreClock * 4 + RECORDER_BAUD / 2) / RECORDER_BAUD;
+	UART0_IBRD_R = divider >> 6;
+	UART0_FBRD_R = divider & 0x3F;
+	UART0_LCRH_R = 0x70;               // 8 bits, no parity, 1 stop bit, FIFOs on
+	UART0_CC_R = 0;                    // system clock
+	UART0_IFLS_R = 0;                  // interrupt when the TX FIFO drops to 1/8
+	UART0_IM_R = UART_IM_TXIM;
+	UART0_CTL_R = 0x101;               // enable UART and transmitter
+
+	NVIC->IP[5] = 6 << 5;              // below the ADC and OS interrupts
+	NVIC->ISER[0] = 1 << 5;
+
+	status = StartCritical();
+	recorder_put = 0;
+	recorder_get = 0;
+	recorder_drops = 0;
+	recorder_tx_bytes = 0;
+	recorder_tx_idle = 1;
+	recorder_stats.records = 0;
+	recorder_stats.dropped = 0;
+	recorder_stats.high_water = 0;
+	CycleStats_Reset(&recorder_stats.put);
+	recorder_last_time = CYCLE_COUNT();
+	Recorder_Add(recorder_last_time, REC_START, RECORDER_VERSION, RECORDER_MAGIC, 0);
+	Recorder_Add(recorder_last_time, REC_DUTY, duty, 0, 1);
+	EndCritical(status);
+}
+
+// ******** Recorder_Put ************
+// records an event at the current time
+// input:  REC_ type, value (clamped to 0 to 4095)
+// output: none
+void Recorder_Put(uint32_t type, int32_t value) {
+	uint32_t start = CYCLE_COUNT();
+	int32_t status = StartCritical();
+
+	// timestamp taken inside the critical section so records stay in order
+	Recorder_Add(CYCLE_COUNT(), type, value, 0, 1);
+	CycleStats_Add(&recorder_stats.put, start);
+	EndCritical(status);
+}
+
+// ******** Recorder_Rate ************
+// records a change of the conversion rate, called by ADC_SetRate
+// input:  conversions per second, log2 of the CIC decimation ratio
+// output: none
+void Recorder_Rate(uint32_t rate, uint32_t decimation_shift) {
+	int32_t status = StartCritical();
+	Recorder_Add(CYCLE_COUNT(), REC_RATE, decimation_shift, rate > 0xFFFF ? 0xFFFF : rate, 0);
+	EndCritical(status);
+}
+
+// Sends records until the TX FIFO is full or the buffer is empty. The
+// interrupt fires again once the FIFO has drained to 1/8.
+void UART0_Handler(void) {
+	int32_t status;
+
+	UART0_ICR_R = UART_ICR_TXIC;
+	while ((UART0_FR_R & UART_FR_TXFF) == 0) {
+		if (recorder_tx_bytes == 0) {
+			if (recorder_get == recorder_put) {
+				break;
+			}
+			recorder_tx_word = recorder_buf[recorder_get & (RECORDER_SIZE - 1)];
+			recorder_get = recorder_get + 1;
+			recorder_tx_bytes = 4;
+		}
+		UART0_DR_R = recorder_tx_word & 0xFF; // little-endian
+		recorder_tx_word >>= 8;
+		--recorder_tx_bytes;
+	}
+
+	// a record put after the check above must see the UART still busy
+	status = StartCritical();
+	if (recorder_tx_bytes == 0 && recorder_get == recorder_put) {
+		recorder_tx_idle = 1;
+	}
+	EndCritical(status);
+}
@@ -0,0 +1,41 @@
+// Recorder.h
+// Runs on TM4C123
+// Records the inputs and outputs of the speed loop so a run can be
+// replayed on a host with tools/replay.c: raw ADC samples, keypad keys,
+// setpoints, the speed each control iteration used and the duty it set.
+// The records are streamed out of UART0 (the debug virtual COM port) by
+// its transmit interrupt.
+// The stream format is in Record_Format.h.
+
+#ifndef RECORDER_H
+#define RECORDER_H
+
+#include <stdint.h>
+#include "Cycle_Count.h"
+#include "Record_Format.h"
+
+// 1 records and streams the speed loop, 0 leaves it out
+#ifndef RECORDER
+#define RECORDER	0
+#endif
+
+// UART0 baud rate. A 10 kHz conversion rate needs about 520 kbaud.
+#define RECORDER_BAUD	1000000
+
+// words buffered for the UART, must be a power of two
+#define RECORDER_SIZE	1024
+
+typedef struct {
+	uint32_t records;     // words put in the buffer
+	uint32_t dropped;     // records lost because the buffer was full
+	uint32_t high_water;  // most words ever waiting in the buffer
+	CycleStats put;       // execution time of Recorder_Put
+} Recorder_Stats;
+
+extern Recorder_Stats recorder_stats;
+
+void Recorder_Init(uint32_t duty);
+void Recorder_Put(uint32_t type, int32_t value);
+void Recorder_Rate(uint32_t rate, uint32_t decimation_shift);
+
+#endif
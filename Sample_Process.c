@@ -0,0 +1,218 @@
+// Sample_Process.c
+// Runs on TM4C123, or on a host for replaying recordings
+// Turns raw ADC samples into the motor voltage. Everything here is
+// plain arithmetic on the samples, so a recording fed through it on a
+// host gives the same results as the board.
+
+#include <stdint.h>
+#include "Sample_Process.h"
+#include "Voltage2RPM.h"
+
+// the last AVG_WINDOW samples, in millivolts
+int32_t sample_window[AVG_WINDOW];
+
+// position of the oldest sample in sample_window
+uint32_t sample_index = 0;
+
+// the average voltage at the DC motor, updated on every conversion
+int32_t average_millivolts = 0;
+
+// running sum of sample_window
+int32_t accum_millivolts = 0;
+
+// samples processed since start-up, wraps
+uint32_t processed_samples = 0;
+
+// model-based speed estimate, updated on every sample
+Observer_Type speed_observer;
+
+#if FILTER_MEDIAN_N
+Median_Filter adc_median;
+#endif
+// always built so the decimation ratio can be changed by ADC_SetRate,
+// skipped while its shift is 0
+CIC_Filter adc_cic;
+#if FILTER_FIR
+// Q15, sums to 1.0
+const int16_t adc_fir_coeffs[16] __attribute__((aligned(4))) = {
+	112, 243, 618, 1293, 2217, 3225, 4089, 4587,
+	4587, 4089, 3225, 2217, 1293, 618, 243, 112
+};
+FIR_Filter adc_fir;
+#endif
+#if FILTER_BIQUAD
+Biquad_Filter adc_biquad;
+
+// Q14 coefficients of a 500 Hz Butterworth low-pass at the biquad's
+// input rate, the conversion rate after CIC decimation
+typedef struct {
+	uint32_t rate;
+	int16_t b0, b1, b2, a1, a2;
+} Biquad_Coeffs;
+
+const Biquad_Coeffs adc_biquad_coeffs[] = {
+	{ 2000, 4799, 9598, 4799,      0,  2811},
+	{ 5000, 1105, 2210, 1105, -18727,  6763},
+	{10000,  329,  658,  329, -25576, 10508},
+	{20000,   91,  182,   91, -29141, 13120},
+	{40000,   24,   48,   24, -30950, 14662},
+};
+#define NUM_BIQUAD_COEFFS	(sizeof(adc_biquad_coeffs) / sizeof(adc_biquad_coeffs[0]))
+#endif
+
+// Code to millivolt conversion, same arithmetic as the original
+// Sample_to_Millivolts: 205 sample ticks = 1 V, and the division is
+// unsigned because the scale constant is. Only the codes the ADC can
+// produce are tabulated, 4096 in 12-bit mode and 256 in 8-bit mode.
+#define MV_SCALE	205u
+#define MV(s)	((int32_t)((uint32_t)(1000 * (((s) & 0x800) ? 0 - (s) : (s))) / MV_SCALE))
+#define MVC(c)	MV((c) << ADC_CODE_SHIFT)
+#define MV4(c)	MVC(c), MVC((c) + 1), MVC((c) + 2), MVC((c) + 3)
+#define MV16(c)	MV4(c), MV4((c) + 4), MV4((c) + 8), MV4((c) + 12)
+#define MV64(c)	MV16(c), MV16((c) + 16), MV16((c) + 32), MV16((c) + 48)
+#define MV256(c)	MV64(c), MV64((c) + 64), MV64((c) + 128), MV64((c) + 192)
+#define MV1024(c)	MV256(c), MV256((c) + 256), MV256((c) + 512), MV256((c) + 768)
+
+const int32_t Millivolt_Table[ADC_CODES] = {
+#if ADC_12BIT
+	MV1024(0), MV1024(1024), MV1024(2048), MV1024(3072)
+#else
+	MV256(0)
+#endif
+};
+
+#if ADC_CALIBRATION
+// per-board gain (Q16.16) and offset (millivolts), selected with ADC_BOARD
+const ADC_Calibration ADC_Calibration_Table[] = {
+	{65536, 0},   // board 0: nominal
+};
+
+ADC_Calibration adc_calibration;
+
+// ******** ADC_SetCalibration ************
+// changes the gain and offset applied after the table lookup
+// input:  Q16.16 gain, offset in millivolts
+// output: none
+void ADC_SetCalibration(int32_t gain, int32_t offset) {
+	adc_calibration.gain = gain;
+	adc_calibration.offset = offset;
+}
+#endif
+
+// Assumes that the input signal to the ADC is between +10V and -10V,
+// returns the voltage of the sample in millivolts
+int32_t Sample_to_Millivolts(int32_t sample) {
+	int32_t retVal = Millivolt_Table[(sample & 0xFFF) >> ADC_CODE_SHIFT];
+
+#if ADC_CALIBRATION
+	retVal = (int32_t)(((int64_t)retVal * adc_calibration.gain) >> 16) + adc_calibration.offset;
+#endif
+
+	return retVal;
+}
+
+// ******** ADC_Filter_Init ************
+// clears the state of the enabled filter stages
+void ADC_Filter_Init(void) {
+#if FILTER_MEDIAN_N
+	Median_Init(&adc_median, FILTER_MEDIAN_N);
+#endif
+	CIC_Init(&adc_cic, FILTER_CIC_ORDER, FILTER_CIC_SHIFT);
+#if FILTER_FIR
+	FIR_Init(&adc_fir, adc_fir_coeffs, 16);
+#endif
+#if FILTER_BIQUAD
+	Biquad_Init(&adc_biquad, 329, 658, 329, -25576, 10508);
+#endif
+}
+
+// ******** ADC_Filter ************
+// runs one sample through the enabled filter stages
+// input:  sample in millivolts, where to store the filtered value
+// output: 1 if *out was written, 0 if a decimating stage held the sample
+static int ADC_Filter(int32_t in, int32_t *out) {
+	int32_t v = in;
+#if FILTER_MEDIAN_N
+	Median_Step(&adc_median, v, &v);
+#endif
+	if (adc_cic.shift && !CIC_Step(&adc_cic, v, &v)) {
+		return 0;
+	}
+#if FILTER_FIR
+	FIR_Step(&adc_fir, v, &v);
+#endif
+#if FILTER_BIQUAD
+	Biquad_Step(&adc_biquad, v, &v);
+#endif
+	*out = v;
+	return 1;
+}
+
+// ******** Sample_Process_Init ************
+// clears the moving average, filters and observer, and loads the
+// board calibration
+// input:  conversions per second
+// output: none
+void Sample_Process_Init(uint32_t rate) {
+	uint32_t i;
+
+	for (i = 0; i < AVG_WINDOW; i++) {
+		sample_window[i] = 0;
+	}
+	sample_index = 0;
+	average_millivolts = 0;
+	accum_millivolts = 0;
+	processed_samples = 0;
+	Observer_Init(&speed_observer, rate);
+	ADC_Filter_Init();
+#if ADC_CALIBRATION
+	adc_calibration = ADC_Calibration_Table[ADC_BOARD];
+#endif
+}
+
+// ******** Sample_Process_SetRate ************
+// adapts the rate-dependent stages to a new conversion rate: the CIC
+// decimation ratio, the observer and the biquad coefficients
+// input:  conversions per second, log2 of the decimation ratio
+// output: log2 of the decimation ratio applied, see CIC_MAX_SHIFT
+uint32_t Sample_Process_SetRate(uint32_t rate, uint32_t decimation_shift) {
+	decimation_shift = CIC_Init(&adc_cic, FILTER_CIC_ORDER, decimation_shift);
+	Observer_SetRate(&speed_observer, rate);
+
+#if FILTER_BIQUAD
+	{
+		// closest tabulated rate
+		uint32_t i, best = 0;
+		uint32_t filter_rate = rate >> decimation_shift;
+		for (i = 1; i < NUM_BIQUAD_COEFFS; i++) {
+			if (filter_rate > (adc_biquad_coeffs[i - 1].rate + adc_biquad_coeffs[i].rate) / 2) {
+				best = i;
+			}
+		}
+		Biquad_Init(&adc_biquad, adc_biquad_coeffs[best].b0, adc_biquad_coeffs[best].b1,
+		            adc_biquad_coeffs[best].b2, adc_biquad_coeffs[best].a1, adc_biquad_coeffs[best].a2);
+	}
+#endif
+	return decimation_shift;
+}
+
+// ******** Sample_Process ************
+// converts one raw sample, updates the observer and, when the filters
+// pass a value on, the moving average
+// input:  raw sample from Retrieve_Sample_ADC, PWM duty at the time
+// output: none
+void Sample_Process(int32_t sample, uint32_t duty) {
+	int32_t millivolts = Sample_to_Millivolts(sample);
+
+	++processed_samples;
+	Observer_Update(&speed_observer, duty, Current_speed(millivolts));
+
+	if (ADC_Filter(millivolts, &millivolts)) {
+		// replace the oldest sample in the window
+		accum_millivolts += millivolts - sample_window[sample_index];
+		sample_window[sample_index] = millivolts;
+		sample_index = (sample_index + 1) & (AVG_WINDOW - 1);
+
+		average_millivolts = accum_millivolts >> AVG_WINDOW_SHIFT;
+	}
+}
@@ -0,0 +1,86 @@
+// Sample_Process.h
+// Runs on TM4C123, or on a host for replaying recordings
+// Turns raw ADC samples into the motor voltage: millivolt conversion,
+// calibration, filter stages, moving average and the speed observer.
+// There is no hardware access here, ADC_Process feeds it on the target
+// and tools/replay.c feeds it recorded samples.
+
+#ifndef SAMPLE_PROCESS_H
+#define SAMPLE_PROCESS_H
+
+#include <stdint.h>
+#include "Filter.h"
+#include "PWM.h"
+#include "Observer.h"
+
+// 1 reads all 12 bits of each conversion as two bytes using BYTE (PC7),
+// 0 reads only the MSB byte with BYTE tied low
+#ifndef ADC_12BIT
+#define ADC_12BIT	0
+#endif
+
+// Sample_to_Millivolts looks the code up in Millivolt_Table. Without
+// ADC_12BIT the 4 LSBs of a sample are always zero and are not tabulated.
+#if ADC_12BIT
+#define ADC_CODE_SHIFT	0
+#else
+#define ADC_CODE_SHIFT	4
+#endif
+#define ADC_CODES	(4096 >> ADC_CODE_SHIFT)
+extern const int32_t Millivolt_Table[ADC_CODES];
+
+// 1 applies a per-board gain and offset after the table lookup
+#ifndef ADC_CALIBRATION
+#define ADC_CALIBRATION	0
+#endif
+#ifndef ADC_BOARD
+#define ADC_BOARD	0
+#endif
+
+typedef struct {
+	int32_t gain;    // Q16.16, 65536 is 1.0
+	int32_t offset;  // millivolts
+} ADC_Calibration;
+
+#if ADC_CALIBRATION
+extern const ADC_Calibration ADC_Calibration_Table[];
+extern ADC_Calibration adc_calibration;
+void ADC_SetCalibration(int32_t gain, int32_t offset);
+#endif
+
+// filter stages between adc_ring and the moving average, applied in
+// this order. 0 turns a stage off.
+#define FILTER_MEDIAN_N	0   // odd median window, rejects spikes
+#define FILTER_CIC_SHIFT	0   // initial log2 of the CIC decimation ratio
+#define FILTER_CIC_ORDER	3
+#define FILTER_FIR	0   // 16-tap low-pass, cutoff 0.05 of the input rate
+#define FILTER_BIQUAD	0   // 2nd order Butterworth low-pass, 500 Hz at 10 kHz
+
+// the moving average covers the last AVG_WINDOW samples,
+// which must be a power of two so no divide is needed.
+// Full 12-bit samples have less quantization noise and need a shorter
+// window. Samples synchronized to the PWM have no PWM ripple at all and
+// arrive once per PWM period, so one of them is already steadier than
+// 128 Timer0A samples (tools/sync_sim.c) and is used as is.
+#if ADC_PWM_SYNC
+#define AVG_WINDOW_SHIFT	0
+#elif ADC_12BIT
+#define AVG_WINDOW_SHIFT	5
+#else
+#define AVG_WINDOW_SHIFT	7
+#endif
+#define AVG_WINDOW	(1 << AVG_WINDOW_SHIFT)
+
+extern uint32_t sample_index;
+extern int32_t average_millivolts;
+extern int32_t accum_millivolts;
+extern uint32_t processed_samples;
+extern Observer_Type speed_observer;
+
+int32_t Sample_to_Millivolts(int32_t sample);
+void ADC_Filter_Init(void);
+void Sample_Process_Init(uint32_t rate);
+uint32_t Sample_Process_SetRate(uint32_t rate, uint32_t decimation_shift);
+void Sample_Process(int32_t sample, uint32_t duty);
+
+#endif
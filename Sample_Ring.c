@@ -0,0 +1,69 @@
+// Sample_Ring.c
+// Runs on TM4C123
+// Lock-free single-producer/single-consumer ring of timestamped ADC samples.
+// put and get run freely and are masked on access, so the ring holds
+// all SAMPLE_RING_SIZE entries and put - get is always the fill level.
+
+#include <stdint.h>
+#include "Sample_Ring.h"
+#include "TM4C123GH6PM.h"
+
+// ******** SampleRing_Init ************
+// empties the ring and clears its counters
+// input:  ring
+// output: none
+void SampleRing_Init(SampleRing *ring) {
+	ring->put = 0;
+	ring->get = 0;
+	ring->overruns = 0;
+	ring->high_water = 0;
+}
+
+// ******** SampleRing_Put ************
+// adds a sample, called only by the producer
+// input:  ring, raw sample, timestamp
+// output: 0 if successful, -1 if the ring was full and the sample was dropped
+int SampleRing_Put(SampleRing *ring, int32_t sample, uint32_t time) {
+	uint32_t put = ring->put;
+	uint32_t count = put - ring->get;
+
+	if (count >= SAMPLE_RING_SIZE) {
+		ring->overruns++;
+		return -1;
+	}
+
+	ring->buf[put & (SAMPLE_RING_SIZE - 1)].time = time;
+	ring->buf[put & (SAMPLE_RING_SIZE - 1)].sample = sample;
+	__DMB(); // entry must be written before it is published
+	ring->put = put + 1;
+
+	if (count + 1 > ring->high_water) {
+		ring->high_water = count + 1;
+	}
+	return 0;
+}
+
+// ******** SampleRing_Get ************
+// removes the oldest sample, called only by the consumer
+// input:  ring, where to store the sample
+// output: 1 if a sample was returned, 0 if the ring was empty
+int SampleRing_Get(SampleRing *ring, ADC_Sample *out) {
+	uint32_t get = ring->get;
+
+	if (get == ring->put) {
+		return 0;
+	}
+
+	__DMB(); // read the entry only after seeing it published
+	*out = ring->buf[get & (SAMPLE_RING_SIZE - 1)];
+	__DMB(); // entry must be read before the slot is released
+	ring->get = get + 1;
+	return 1;
+}
+
+// ******** SampleRing_Count ************
+// input:  ring
+// output: number of samples waiting
+uint32_t SampleRing_Count(SampleRing *ring) {
+	return ring->put - ring->get;
+}
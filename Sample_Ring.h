@@ -0,0 +1,33 @@
+// Sample_Ring.h
+// Runs on TM4C123
+// Lock-free single-producer/single-consumer ring of timestamped ADC samples.
+// The producer is GPIOC_Handler, the consumer is the ADC_Process thread.
+// Neither side needs to disable interrupts.
+
+#ifndef SAMPLE_RING_H
+#define SAMPLE_RING_H
+
+#include <stdint.h>
+
+// must be a power of two
+#define SAMPLE_RING_SIZE	64
+
+typedef struct {
+	uint32_t time;   // CYCLE_COUNT() when the conversion was read
+	int32_t sample;  // raw sample from Retrieve_Sample_ADC
+} ADC_Sample;
+
+typedef struct {
+	volatile uint32_t put;  // written only by the producer
+	volatile uint32_t get;  // written only by the consumer
+	uint32_t overruns;      // samples dropped because the ring was full
+	uint32_t high_water;    // most samples ever waiting in the ring
+	ADC_Sample buf[SAMPLE_RING_SIZE];
+} SampleRing;
+
+void SampleRing_Init(SampleRing *ring);
+int SampleRing_Put(SampleRing *ring, int32_t sample, uint32_t time);
+int SampleRing_Get(SampleRing *ring, ADC_Sample *out);
+uint32_t SampleRing_Count(SampleRing *ring);
+
+#endif
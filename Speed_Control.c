@@ -0,0 +1,26 @@
+// Speed_Control.c
+// Motor speed control law, shared by the Controller thread and the
+// host simulation in tools/. No hardware access.
+
+#include <stdint.h>
+#include "Speed_Control.h"
+
+// ******** Speed_Control_Init ************
+// input:  controller state
+// output: none
+void Speed_Control_Init(PID_Type *pid) {
+	PID_Init(pid, CONTROL_KP, CONTROL_KI, CONTROL_KD, PID_ONE / 4, 0, CONTROL_MAX_DUTY);
+}
+
+// ******** Speed_Control_Step ************
+// one control iteration. A zero setpoint stops the motor and clears
+// the controller; the feedforward is only used above CONTROL_KF RPM.
+// input:  controller state, desired and measured speed (RPM)
+// output: PWM duty count
+int32_t Speed_Control_Step(PID_Type *pid, int32_t des_rpm, int32_t cur_rpm) {
+	if (des_rpm == 0) {
+		PID_Reset(pid, cur_rpm);
+		return 0;
+	}
+	return PID_Update(pid, des_rpm, cur_rpm, (des_rpm < CONTROL_KF) ? 0 : CONTROL_KF);
+}
@@ -0,0 +1,20 @@
+// Speed_Control.h
+// Motor speed control law, shared by the Controller thread and the
+// host simulation in tools/.
+
+#ifndef SPEED_CONTROL_H
+#define SPEED_CONTROL_H
+
+#include <stdint.h>
+#include "PID.h"
+
+#define CONTROL_KP	PID_Q16(0.75)  // proportional gain
+#define CONTROL_KI	0              // integral gain per iteration
+#define CONTROL_KD	0              // derivative gain
+#define CONTROL_KF	500            // feedforward duty, used above 500 RPM
+#define CONTROL_MAX_DUTY	2500   // PWM period
+
+void Speed_Control_Init(PID_Type *pid);
+int32_t Speed_Control_Step(PID_Type *pid, int32_t des_rpm, int32_t cur_rpm);
+
+#endif
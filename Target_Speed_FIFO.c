@@ -6,15 +6,15 @@ uint8_t Target_Speed_FIFO[FIFOSIZE];
 
 uint8_t volatile *PutPt;	// put next
 uint8_t volatile *GetPt;	// get next
-int32_t CurrentSize;		// 0 means FIFO is empty
-int32_t FIFOMutex;			// exclusive access to FIFO
+Sema4Type CurrentSize;		// 0 means FIFO is empty
+Sema4Type FIFOMutex;			// exclusive access to FIFO
 uint32_t LostData;
 
 void OS_FIFO_Init(void) {
 	PutPt = &Target_Speed_FIFO[0];
 	GetPt = &Target_Speed_FIFO[0];
-	OS_InitSemaphore(&CurrentSize, 0);
-	OS_InitSemaphore(&FIFOMutex, 1);
+	OS_InitSemaphore(&CurrentSize, 0, WQ_FIFO);
+	OS_InitSemaphore(&FIFOMutex, 1, WQ_FIFO);
 	LostData = 0;
 	
 	for (int i = 0; i < FIFOSIZE; ++i) {
@@ -22,9 +22,14 @@ void OS_FIFO_Init(void) {
 	}
 }
 
+// Callable from threads and from interrupts at OS_KERNEL_PRIORITY or
+// below. A getter waiting on CurrentSize that outranks the caller runs
+// as soon as the put returns, or at the end of the interrupt.
 int OS_FIFO_Put(uint8_t data) {
-	if (CurrentSize == FIFOSIZE) {
+	OS_CriticalEnter();
+	if (CurrentSize.Value == FIFOSIZE) {
 		LostData++;	// error
+		OS_CriticalExit();
 		return -1;
 	}
 	
@@ -36,6 +41,7 @@ int OS_FIFO_Put(uint8_t data) {
 	}
 	
 	OS_Signal(&CurrentSize);
+	OS_CriticalExit();
 	return 0; // success
 }
 
@@ -55,11 +61,11 @@ uint8_t OS_FIFO_Get(void) {
 }
 
 int OS_FIFO_Full(void) {
-	return CurrentSize == FIFOSIZE;
+	return CurrentSize.Value == FIFOSIZE;
 }
 
 int OS_FIFO_Empty(void) {
-	return CurrentSize == 0;
+	return CurrentSize.Value == 0;
 }
 
 // Get the data at GetPt's position
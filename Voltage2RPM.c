@@ -5,12 +5,25 @@
 // John Tadrous
 // October 2, 2020
 
-#include "tm4c123gh6pm.h"
-#include "tm4c123gh6pm_def.h"
+// The single linear fit is replaced by linear interpolation in RPM_Table,
+// which is fitted to measured (mV, RPM) data with tools/rpm_fit.c.
+// Breakpoints are a power of two apart, so there is no divide. Below
+// RPM_CUTOFF_MV the speed is 0, as with the old fit.
+
+#include <stdint.h>
+#include "Voltage2RPM.h"
+#include "RPM_Table.h"
 
 
 int32_t Current_speed(int32_t Avg_volt){ // This function returns the current
                                            // DC motor RPM given the voltage in mV
-  if (Avg_volt<= 1200) {return 0;}
-  else {return ((21408*Avg_volt)>>16)-225;}
+  uint32_t i, frac;
+  int32_t rpm;
+  if (Avg_volt < RPM_CUTOFF_MV) {return 0;}
+  if (Avg_volt >= ((RPM_TABLE_SIZE-1) << RPM_TABLE_SHIFT)) {return RPM_Table[RPM_TABLE_SIZE-1];}
+  i = Avg_volt >> RPM_TABLE_SHIFT;                  // segment
+  frac = Avg_volt & ((1 << RPM_TABLE_SHIFT) - 1);   // position in the segment
+  rpm = RPM_Table[i] + (((RPM_Table[i+1] - RPM_Table[i]) * (int32_t)frac) >> RPM_TABLE_SHIFT);
+  if (rpm < 0) {return 0;}
+  return rpm;
 }
@@ -0,0 +1,11 @@
+// Voltage2RPM.h
+// Conversion of the average motor voltage to DC motor speed.
+
+#ifndef VOLTAGE2RPM_H
+#define VOLTAGE2RPM_H
+
+#include <stdint.h>
+
+int32_t Current_speed(int32_t Avg_volt);
+
+#endif
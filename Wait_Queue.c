@@ -0,0 +1,95 @@
+// Wait_Queue.c
+// Runs on TM4C123, or on a host for benchmarking
+// Queue of threads blocked on a semaphore. The callers disable interrupts.
+
+#include <stdint.h>
+#include "Wait_Queue.h"
+
+// ******** WaitQueue_Init ************
+// input:  queue, WQ_PRIORITY or WQ_FIFO
+// output: none
+void WaitQueue_Init(WaitQueue *q, uint32_t policy) {
+	q->head = 0;
+	q->tail = 0;
+	q->policy = policy;
+}
+
+// ******** WaitQueue_Put ************
+// queues a waiter. With WQ_FIFO, or with WQ_PRIORITY when no waiter has
+// a lower priority, it goes on the tail. Otherwise it walks the waiters
+// of equal or higher priority.
+// input:  queue, entry not in any queue, priority of the waiter
+// output: none
+void WaitQueue_Put(WaitQueue *q, WQ_Node *n, uint32_t priority) {
+	WQ_Node *prev;
+
+	n->priority = priority;
+	if (q->head == 0) {
+		n->next = 0;
+		q->head = n;
+		q->tail = n;
+		return;
+	}
+	if ((q->policy == WQ_FIFO) || (q->tail->priority <= priority)) {
+		n->next = 0;
+		q->tail->next = n;
+		q->tail = n;
+		return;
+	}
+	if (q->head->priority > priority) {
+		n->next = q->head;
+		q->head = n;
+		return;
+	}
+	prev = q->head;
+	while (prev->next->priority <= priority) {  // stops before the tail
+		prev = prev->next;
+	}
+	n->next = prev->next;
+	prev->next = n;
+}
+
+// ******** WaitQueue_Get ************
+// takes off the waiter to wake
+// input:  queue
+// output: waiter, 0 if none
+WQ_Node *WaitQueue_Get(WaitQueue *q) {
+	WQ_Node *n = q->head;
+
+	if (n) {
+		q->head = n->next;
+		if (q->head == 0) {
+			q->tail = 0;
+		}
+		n->next = 0;
+	}
+	return n;
+}
+
+// ******** WaitQueue_Remove ************
+// takes a waiter out before it is woken, e.g. when its wait times out.
+// Walks the waiters ahead of it.
+// input:  queue, entry
+// output: 1 if it was in the queue, 0 if not
+int WaitQueue_Remove(WaitQueue *q, WQ_Node *n) {
+	WQ_Node *prev = 0;
+	WQ_Node *pt = q->head;
+
+	while (pt && (pt != n)) {
+		prev = pt;
+		pt = pt->next;
+	}
+	if (pt == 0) {
+		return 0;
+	}
+	if (prev) {
+		prev->next = n->next;
+	} else {
+		q->head = n->next;
+	}
+	if (q->tail == n) {
+		q->tail = prev;
+	}
+	n->next = 0;
+	return 1;
+}
@@ -0,0 +1,35 @@
+// Wait_Queue.h
+// Runs on TM4C123, or on a host for benchmarking
+// Queue of threads blocked on a semaphore, linked through a node in each
+// waiter, so the OS never searches the thread table. The next waiter to
+// wake is always the head: either the one that has waited longest, or
+// the highest priority one, and among equal priorities the one that has
+// waited longest.
+
+#ifndef WAIT_QUEUE_H
+#define WAIT_QUEUE_H
+
+#include <stdint.h>
+
+// wakeup order
+#define WQ_PRIORITY	0   // highest priority first, 0 is the highest
+#define WQ_FIFO	1   // longest waiting first
+
+// embedded in whatever waits, e.g. a thread control block
+typedef struct WQ_Node {
+	struct WQ_Node *next;
+	uint32_t priority;  // of the waiter when it was queued
+} WQ_Node;
+
+typedef struct {
+	WQ_Node *head;      // wakes next, 0 if empty
+	WQ_Node *tail;      // queued last
+	uint32_t policy;    // WQ_PRIORITY or WQ_FIFO
+} WaitQueue;
+
+void WaitQueue_Init(WaitQueue *q, uint32_t policy);
+void WaitQueue_Put(WaitQueue *q, WQ_Node *n, uint32_t priority);
+WQ_Node *WaitQueue_Get(WaitQueue *q);
+int WaitQueue_Remove(WaitQueue *q, WQ_Node *n);
+
+#endif
@@ -1,11 +1,72 @@
+#ifndef OS_H
+#define OS_H
+
 #include <stdint.h>
+#include "Wait_Queue.h"
+#include "Cycle_Count.h"
 
 void OS_Init(void);
-void SetInitialStack(int i);
+
+// counting semaphore. Value < 0 is the number of threads in Waiters.
+// A zeroed Sema4Type is a semaphore of value 0 with WQ_PRIORITY order.
+typedef struct {
+	int32_t Value;
+	WaitQueue Waiters;
+} Sema4Type;
+
+// lock with an owner, for threads only. A thread waiting for it lends
+// its priority to the owner, and on to the owner's owner if that one is
+// waiting for another mutex, until the owner unlocks. Unlocking hands it
+// straight to the highest priority waiter.
+typedef struct Mutex {
+	void *Owner;          // thread holding it, 0 if free
+	struct Mutex *NextHeld; // next mutex held by the same owner
+	WaitQueue Waiters;    // always WQ_PRIORITY
+	uint32_t LockedAt;    // CYCLE_COUNT() when the owner got it
+	CycleStats Hold;      // cycles from each lock until its unlock
+	uint32_t Contended;   // locks that found it held
+	uint32_t Timeouts;    // timed locks that gave up
+	uint32_t Recursions;  // locks by the thread already holding it
+} MutexType;
+
+// results of OS_Lock, OS_LockTimeout and OS_Unlock
+#define OS_MUTEX_OK         0
+#define OS_MUTEX_TIMEOUT    (-1) // still held by another thread
+#define OS_MUTEX_RECURSIVE  (-2) // the caller already holds it
+#define OS_MUTEX_NOT_OWNER  (-3) // unlock by a thread not holding it
+
+// filled in by OS_GetThreadInfo
+typedef struct {
+	const char *name;
+	uint8_t priority;     // fixed priority, 0 is the highest
+	uint32_t stackWords;  // stack size, rounded up to an even number of words
+	uint32_t stackUsed;   // most stack words ever used
+} OS_ThreadInfo;
+
+int OS_AddThread(void(*task)(void), uint32_t stackWords, uint32_t priority, const char *name);
 int OS_AddThreads(void(*task0)(void),void(*task1)(void),void(*task2)(void),void(*task3)(void));
+int OS_GetThreadInfo(uint32_t id, OS_ThreadInfo *info);
 void OS_Launch(uint32_t theTimeSlice);
 void Clock_Init(void);
-void OS_Wait(int32_t *S);
-void OS_Signal(int32_t *S);
+void OS_Wait(Sema4Type *S);
+void OS_Signal(Sema4Type *S);
 void OS_Sleep(uint32_t SleepCtr);
-void OS_InitSemaphore(int32_t*, int32_t);
\ No newline at end of file
+void OS_SleepUs(uint32_t us);
+uint32_t OS_Time(void);
+uint32_t OS_IdleTime(void);
+void OS_InitSemaphore(Sema4Type *S, int32_t value, uint32_t policy);
+void OS_InitMutex(MutexType *m);
+int OS_Lock(MutexType *m);
+int OS_LockTimeout(MutexType *m, uint32_t us);
+int OS_Unlock(MutexType *m);
+
+// Interrupts at priority OS_KERNEL_PRIORITY to 7 may call the OS, and
+// are masked by its critical sections through BASEPRI. Interrupts at
+// priority 0 to OS_KERNEL_PRIORITY - 1 are never delayed by the OS and
+// must not call it, except for OS_SignalDeferred.
+#define OS_KERNEL_PRIORITY	3
+void OS_CriticalEnter(void);
+void OS_CriticalExit(void);
+void OS_SignalDeferred(Sema4Type *S);
+
+#endif
@@ -10,6 +10,10 @@
 
 #include "TM4C123GH6PM.h"
 #include "tm4c123gh6pm_def.h"
+#include "os.h"
+#include "Cycle_Count.h"
+#include "Delta_Queue.h"
+#include <stddef.h>
 
 
 
@@ -23,14 +27,47 @@ void EndCritical(int32_t primask);
 void Clock_Init(void);
 void StartOS(void);
 void Scheduler(void);
-void OS_InitSemaphore(int32_t *Sem, int32_t val);
 
 
-#define NUMTHREADS  4        // maximum number of threads
-#define STACKSIZE   100      // number of 32-bit words in stack
+#define NUMTHREADS  8        // maximum number of threads, with the idle thread
+#define STACKSIZE   100      // stack words of threads added by OS_AddThreads
+
+// All thread stacks come from StackPool, so its size is the RAM for
+// stacks and shows in the linker map. The linker callgraph
+// (DC_Stepper_Motor.htm) lists the worst-case stack depth of each
+// thread function. Threads run on MSP, so each stack must also hold the
+// frames of nested interrupts. A thread that uses the FPU needs about
+// 34 more words, for S16-S31 and the longer frame of each interrupt.
+#define STACK_POOL_WORDS  1024
+#define MIN_STACK   32       // initial frame plus room for one interrupt
+#define STACK_PAINT 0xA5A5A5A5 // fill of unused stack words
+
+// Scheduling: the highest priority ready thread runs, and ready threads
+// of equal priority take turns each time slice. Bit 31 - p of ReadyBits
+// is set while priority p has a ready thread, so __CLZ(ReadyBits) is
+// the priority to run.
+#define NUM_PRIORITIES  32   // 0 is the highest
+
+// 1 raises the working priority of a ready thread by one for every
+// AGE_LIMIT time slices it waits, so low priority threads cannot starve.
+// It drops back to the fixed priority once the thread has run.
+#ifndef OS_AGING
+#define OS_AGING    0
+#endif
+#define AGE_LIMIT   50
+
+// Tickless timing: TIMER1A counts up at the bus clock as OS_Time, and
+// its match interrupt is set to the next wakeup in SleepQueue. SysTick
+// only runs while two ready threads share a priority, so there are no
+// time slices while the idle thread runs.
+#define BUS_MHZ       16     // OS_Time counts per microsecond
+#define SLEEP_MAX     0x7FFFFFFF // longest sleep, OS_Time counts (134 s)
+#define WAKE_MARGIN   32     // OS_Time counts, a closer match could be missed
+#define IDLE_PRIORITY (NUM_PRIORITIES - 1) // for the idle thread alone
+#define IDLE_STACK    64
 
 int32_t Mail;		// mailbox support
-int32_t Send;    // mailbox semaphore
+Sema4Type Send;  // mailbox semaphore
 uint32_t Lost_mailbox;     // mailbox lost data
 
 
@@ -38,94 +75,531 @@ uint32_t Lost_mailbox;     // mailbox lost data
 
 struct tcb{						// thread control block supports blocking, sleeping and priority
   int32_t *sp;       // pointer to stack (valid for threads not running
-  struct tcb *next;  // linked-list pointer
-	int32_t	*blocked;  // nonzero if blocked on this semaphore
+  struct tcb *next;  // next ready thread of the same priority
+  struct tcb *prev;  // previous ready thread of the same priority
+	Sema4Type *blocked; // nonzero if blocked on this semaphore
+	WQ_Node WaitNode;  // entry in blocked->Waiters or locking->Waiters
+	MutexType *locking; // nonzero if waiting for this mutex
+	MutexType *held;   // mutexes held, linked by NextHeld
 	uint32_t Sleep; // nonzero if this thread is sleeping
+	DQ_Node SleepNode; // entry in SleepQueue while sleeping
 	uint8_t  WorkingPriority; // used by the scheduler
 	uint8_t FixedPriority; // permanent priority
 	uint32_t Age; // time since last execution
+	int32_t *stack;    // lowest word of the stack
+	uint32_t StackWords; // size of the stack
+	const char *name;  // for debugging and OS_GetThreadInfo
+	uint32_t WokenAt;  // CYCLE_COUNT() of the signal that preempted for it
+	uint8_t Handoff;   // 1 woken by a thread, 2 by an interrupt, 0 measured
 };
 typedef struct tcb tcbType;
 tcbType tcbs[NUMTHREADS];
 tcbType *RunPt;
-int32_t Stacks[NUMTHREADS][STACKSIZE];
+tcbType *NextPt;            // PendSV_Handler switches RunPt to this
+uint32_t NumThreads = 0;  // threads added so far
+
+// ring of ready threads for each priority, the head runs next
+tcbType *ReadyList[NUM_PRIORITIES];
+uint32_t ReadyBits = 0;
+
+// sleeping threads in wakeup order, in OS_Time counts after SleepTime
+DeltaQueue SleepQueue;
+uint32_t SleepTime;
+#define SLEEPER(n)  ((tcbType *)((char *)(n) - offsetof(tcbType, SleepNode)))
+#define WAITER(n)   ((tcbType *)((char *)(n) - offsetof(tcbType, WaitNode)))
+#define OWNER(m)    ((tcbType *)(m)->Owner)
+
+int32_t StackPool[STACK_POOL_WORDS] __attribute__((aligned(8)));
+uint32_t StackPoolUsed = 0; // words handed out
+
+tcbType *IdlePt;            // the idle thread, added by OS_Init
+uint32_t IdleTime = 0;      // OS_Time counts spent in WFI
+uint32_t TimeSlice;         // SysTick period, the unit of OS_Sleep
+
+// cycles in PendSV_Handler, from its first instruction until the new
+// thread's registers are restored. The 12 cycle exception entry and the
+// lazy stacking of S0-S15 are not included.
+CycleStats SwitchInteger = {0xFFFFFFFF, 0, 0, 0}; // neither thread uses the FPU
+CycleStats SwitchFPU = {0xFFFFFFFF, 0, 0, 0};     // S16-S31 saved or restored
+
+// Critical sections raise BASEPRI to mask the interrupts that may call
+// the OS, and nest. The interrupts above OS_KERNEL_PRIORITY run even in
+// the middle of the scheduler.
+#define KERNEL_BASEPRI  (OS_KERNEL_PRIORITY << 5)
+uint32_t CriticalNest = 0;  // sections entered and not yet left
+uint32_t CriticalStart;     // CYCLE_COUNT() when the outermost was entered
+
+// Latency report, in cycles. KernelCritical.max is the longest the OS
+// has delayed an interrupt at OS_KERNEL_PRIORITY or below. SleepLatency
+// is from a TIMER1A match until its handler runs. ADC_Stats has the
+// latency of the ADC trigger, which the OS never delays.
+CycleStats KernelCritical = {0xFFFFFFFF, 0, 0, 0};
+CycleStats SleepLatency = {0xFFFFFFFF, 0, 0, 0};
+
+// handoff latency, from the signal (or sleep end) that makes a thread
+// ready ahead of the running one until that thread runs
+CycleStats HandoffThread = {0xFFFFFFFF, 0, 0, 0}; // signaled by a thread
+CycleStats HandoffISR = {0xFFFFFFFF, 0, 0, 0};    // signaled by an interrupt
+
+// signals from interrupts above OS_KERNEL_PRIORITY, done in PendSV
+#define DEFERRED_SIZE   8    // power of two
+Sema4Type *Deferred[DEFERRED_SIZE];
+uint32_t DeferredTime[DEFERRED_SIZE]; // CYCLE_COUNT() of each signal
+uint32_t DeferredPut = 0;
+uint32_t DeferredGet = 0;
+uint32_t DeferredLost = 0;  // signals dropped because Deferred was full
+static tcbType *AddThread(void(*task)(void), uint32_t stackWords, uint32_t priority, const char *name);
+
+// adds a thread at the tail of its priority's ready ring, so it runs
+// after the others of that priority. Called inside a critical section.
+static void ReadyInsert(tcbType *t){
+  uint32_t p = t->WorkingPriority;
+  tcbType *head = ReadyList[p];
+  if(head == 0){
+    t->next = t;
+    t->prev = t;
+    ReadyList[p] = t;
+    ReadyBits |= 0x80000000 >> p;
+  } else{
+    t->next = head;
+    t->prev = head->prev;
+    head->prev->next = t;
+    head->prev = t;
+  }
+}
+
+// takes a thread out of its priority's ready ring.
+// Called inside a critical section.
+static void ReadyRemove(tcbType *t){
+  uint32_t p = t->WorkingPriority;
+  if(t->next == t){
+    ReadyList[p] = 0;
+    ReadyBits &= ~(0x80000000 >> p);
+  } else{
+    t->prev->next = t->next;
+    t->next->prev = t->prev;
+    if(ReadyList[p] == t){
+      ReadyList[p] = t->next;
+    }
+  }
+}
+
+// ******** OS_CriticalEnter ************
+// masks the interrupts that may call the OS. Sections may be nested,
+// only the outermost OS_CriticalExit unmasks them. A thread must not
+// block inside a section, as the switch waits until it ends.
+// input:  none
+// output: none
+void OS_CriticalEnter(void){
+  __set_BASEPRI(KERNEL_BASEPRI);
+  if(CriticalNest++ == 0){
+    CriticalStart = CYCLE_COUNT();
+  }
+}
+
+// ******** OS_CriticalExit ************
+// ends the section started by the matching OS_CriticalEnter
+// input:  none
+// output: none
+void OS_CriticalExit(void){
+  if(--CriticalNest == 0){
+    CycleStats_Add(&KernelCritical, CriticalStart);
+    __set_BASEPRI(0);
+  }
+}
+
+// starts the time slices again if the scheduler stopped them
+static void TickStart(void){
+  if((NVIC_ST_CTRL_R & 0x01) == 0){
+    NVIC_ST_CURRENT_R = 0;       // a full slice from now
+    NVIC_ST_CTRL_R = 0x00000007; // enable, core clock and interrupt arm
+  }
+}
+
+// 1 if two ready threads of some priority take turns. The slices go on
+// while a higher priority thread runs, or one that preempts more often
+// than TIMESLICE would restart them each time and starve the ring.
+static int TakingTurns(void){
+  uint32_t bits = ReadyBits;
+  tcbType *head;
+  while(bits){
+    head = ReadyList[__CLZ(bits)];
+    if(head->next != head){
+      return 1;
+    }
+    bits &= ~(0x80000000 >> __CLZ(bits));
+  }
+  return 0;
+}
+
+// sets NextPt to the head of the highest priority ready ring, and
+// triggers PendSV if that is not the running thread. The idle thread is
+// always ready, at the lowest priority. The time slices are stopped
+// while no priority has two threads ready; Wakeup starts them again.
+// Called inside a critical section.
+static void Pick(void){
+  NextPt = ReadyList[__CLZ(ReadyBits)];
+  NextPt->Age = 0;
+#if !OS_AGING
+  if(TakingTurns()){
+    TickStart();                 // goes on with a slice already started
+  } else{
+    NVIC_ST_CTRL_R = 0;          // nothing to take turns with
+  }
+#endif
+  if(NextPt != RunPt){
+    NVIC_INT_CTRL_R = 0x10000000; // trigger PendSV
+  }
+}
+
+// makes a woken thread ready. If it outranks the thread about to run it
+// preempts: PendSV switches to it as soon as the critical section, or
+// the interrupt, ends. A thread that joins others of its priority takes
+// its turn at the end of a time slice.
+// Called inside a critical section.
+// input:  thread, CYCLE_COUNT() of the event that woke it
+static void Wakeup(tcbType *t, uint32_t time){
+  ReadyInsert(t);
+  if(t->WorkingPriority < NextPt->WorkingPriority){
+    t->WokenAt = time;
+    t->Handoff = (__get_IPSR() != 0) ? 2 : 1;
+    Pick();
+  } else if(t->next != t){
+    TickStart();
+  }
+}
+
+// the priority a thread runs at: its fixed priority, raised to that of
+// the highest priority thread waiting for a mutex it holds
+static uint32_t BasePriority(tcbType *t){
+  uint32_t p = t->FixedPriority;
+  MutexType *m;
+  for(m = t->held; m; m = m->NextHeld){
+    if(m->Waiters.head && (m->Waiters.head->priority < p)){
+      p = m->Waiters.head->priority;
+    }
+  }
+  return p;
+}
+
+// moves a thread to another priority, in its wait queue if it is
+// waiting and in the ready rings if it is ready.
+// Called inside a critical section.
+static void SetPriority(tcbType *t, uint32_t p){
+  WaitQueue *q = t->locking ? &t->locking->Waiters : (t->blocked ? &t->blocked->Waiters : 0);
+  if(q){
+    if(q->policy == WQ_PRIORITY){
+      WaitQueue_Remove(q, &t->WaitNode);
+      WaitQueue_Put(q, &t->WaitNode, p);
+    }
+    t->WorkingPriority = p;
+  } else if(t->Sleep){
+    t->WorkingPriority = p;
+  } else{
+    ReadyRemove(t);
+    t->WorkingPriority = p;
+    ReadyInsert(t);
+    Pick();
+  }
+}
+
+// brings a mutex owner to its BasePriority after the waiters for its
+// mutexes changed, then the owner of the mutex it is waiting for, and so
+// on down the chain. Called inside a critical section.
+static void Inherit(tcbType *t){
+  uint32_t p;
+  while(t){
+    p = BasePriority(t);
+    if(p == t->WorkingPriority){
+      return;
+    }
+    SetPriority(t, p);
+    t = t->locking ? OWNER(t->locking) : 0;
+  }
+}
+
+// takes a thread whose timed lock ran out off the mutex's Waiters.
+// Called inside a critical section.
+static void LockTimeout(tcbType *t){
+  MutexType *m = t->locking;
+  WaitQueue_Remove(&m->Waiters, &t->WaitNode);
+  t->locking = 0;
+  m->Timeouts++;
+  Inherit(OWNER(m));      // the owner no longer runs for this thread
+}
+
+// ******** OS_Time ************
+// reads the OS clock, which keeps counting while the idle thread sleeps
+// input:  none
+// output: time in bus cycles (62.5 ns), wraps every 268 s
+uint32_t OS_Time(void){
+  return TIMER1_TAV_R;
+}
+
+// wakes the sleeping threads whose time has come and sets the TIMER1A
+// match to the next wakeup. Called inside a critical section.
+static void SleepUpdate(void){
+  DQ_Node *n;
+  uint32_t now = OS_Time();
+  DeltaQueue_Advance(&SleepQueue, now - SleepTime);
+  SleepTime = now;
+  while((n = DeltaQueue_Expired(&SleepQueue)) != 0){
+    SLEEPER(n)->Sleep = 0;
+    if(SLEEPER(n)->locking){
+      LockTimeout(SLEEPER(n));  // a timed lock ran out
+    }
+    Wakeup(SLEEPER(n), CYCLE_COUNT());
+  }
+  if(SleepQueue.head == 0){
+    TIMER1_IMR_R &= ~0x10;      // nothing to wake
+    return;
+  }
+  TIMER1_TAMATCHR_R = now + SleepQueue.head->delta;
+  TIMER1_ICR_R = 0x10;          // clear an old match
+  TIMER1_IMR_R |= 0x10;         // arm the match interrupt
+  if((int32_t)(SleepQueue.head->delta - (OS_Time() - now)) < WAKE_MARGIN){
+    NVIC_PEND0_R = 1 << 21;     // the match may pass before it is set
+  }
+}
+
+// ******** TIMER1A_Handler ************
+// match interrupt at the wakeup time of the head of SleepQueue
+void TIMER1A_Handler(void){
+  OS_CriticalEnter();
+  if(TIMER1_MIS_R & 0x10){      // not pended by SleepUpdate
+    CycleStats_Put(&SleepLatency, OS_Time() - TIMER1_TAMATCHR_R);
+  }
+  TIMER1_ICR_R = 0x10;          // acknowledge timer1A match
+  SleepUpdate();
+  OS_CriticalExit();
+}
 
 
 // ******** OS_Suspend ************
-// suspends the current threads and triggers SysTick 
+// suspends the current thread, runs the scheduler and triggers PendSV
+// to switch threads
 // input:  none
 // output: none
 void OS_Suspend(void){ 
-	NVIC_INT_CTRL_R = 0x04000000; // trigger SysTick
+	OS_CriticalEnter();
+	Scheduler();
+	OS_CriticalExit();
+}
+
+// ******** SysTick_Handler ************
+// end of a time slice: ready threads of the same priority take turns
+void SysTick_Handler(void){
+	OS_CriticalEnter();
+	Scheduler();
+	OS_CriticalExit();
+}
+
+// wakes the head of the semaphore's Waiters if the value allows
+// input:  semaphore pointer, CYCLE_COUNT() of the signal
+static void SignalAt(Sema4Type *s, uint32_t time){
+	WQ_Node *n;
+	OS_CriticalEnter();
+	s->Value = s->Value + 1;
+	if(s->Value <= 0){
+		n = WaitQueue_Get(&s->Waiters);
+		if(n){
+			WAITER(n)->blocked = 0;   // wakeup this one
+			Wakeup(WAITER(n), time);
+		}
+	}
+	OS_CriticalExit();
+}
+
+// ******** OS_SignalDeferred ************
+// signals a semaphore from an interrupt above OS_KERNEL_PRIORITY. The
+// signal is queued and done by PendSV_Handler, so the OS is never run at
+// that priority. Masks all interrupts for the few cycles of the queuing.
+// input:  semaphore pointer
+// output: none
+void OS_SignalDeferred(Sema4Type *s){
+	int32_t status = StartCritical();
+	if(DeferredPut - DeferredGet < DEFERRED_SIZE){
+		Deferred[DeferredPut & (DEFERRED_SIZE - 1)] = s;
+		DeferredTime[DeferredPut & (DEFERRED_SIZE - 1)] = CYCLE_COUNT();
+		DeferredPut++;
+	} else{
+		DeferredLost++;
+	}
+	EndCritical(status);
+	NVIC_INT_CTRL_R = 0x10000000; // trigger PendSV
+}
+
+// ******** OS_RunDeferred ************
+// called by PendSV_Handler before it switches, does the signals queued
+// by OS_SignalDeferred
+// input:  none
+// output: none
+void OS_RunDeferred(void){
+	// this PendSV does the switch for the signals below. A signal queued
+	// after the clear pends PendSV again, so it is never left waiting.
+	NVIC_INT_CTRL_R = 0x08000000; // clear PendSV pending
+	while(DeferredGet != DeferredPut){
+		SignalAt(Deferred[DeferredGet & (DEFERRED_SIZE - 1)],
+			DeferredTime[DeferredGet & (DEFERRED_SIZE - 1)]);
+		DeferredGet++;
+	}
+}
+
+// ******** OS_SwitchDone ************
+// called by PendSV_Handler at the end of each switch to time it
+// input:  CYCLE_COUNT() at the start of PendSV_Handler,
+//         EXC_RETURN of the old and of the new thread
+// output: none
+void OS_SwitchDone(uint32_t start, uint32_t old_return, uint32_t new_return){
+	if((old_return & new_return & 0x10) == 0){
+		CycleStats_Add(&SwitchFPU, start);
+	} else{
+		CycleStats_Add(&SwitchInteger, start);
+	}
+	if(RunPt->Handoff){
+		CycleStats_Add((RunPt->Handoff == 2) ? &HandoffISR : &HandoffThread, RunPt->WokenAt);
+		RunPt->Handoff = 0;
+	}
 }
 
 // ******** OS_Wait ************
-// wait function on a blocking semaphore 
+// wait function on a blocking semaphore, queues the thread in its
+// Waiters if the value goes negative
 // input:  semaphore pointer
 // output: none
-void OS_Wait(int32_t *s){
-	DisableInterrupts();
-	(*s) = (*s) - 1;
-	if((*s) < 0){
+void OS_Wait(Sema4Type *s){
+	OS_CriticalEnter();
+	s->Value = s->Value - 1;
+	if(s->Value < 0){
 		RunPt->blocked = s; // reason it is blocked
-		EnableInterrupts();
-		OS_Suspend();       // run thread switcher
+		ReadyRemove(RunPt);
+		WaitQueue_Put(&s->Waiters, &RunPt->WaitNode, RunPt->WorkingPriority);
+		OS_Suspend();       // PendSV switches once the section ends
 	}
-	EnableInterrupts();
+	OS_CriticalExit();
 }
 
 // ******** OS_Signal ************
-// signal function on a blocking semaphore 
+// signal function on a blocking semaphore, wakes the head of its
+// Waiters. If that thread outranks the running one it runs at once, or
+// at the end of the calling interrupt. Callable from threads and from
+// interrupts at OS_KERNEL_PRIORITY or below.
 // input:  semaphore pointer
 // output: none
-void OS_Signal(int32_t *s){
-	tcbType *pt;
-	DisableInterrupts();
-	(*s) = (*s) + 1;
-	if((*s) <= 0){
-		pt = RunPt->next; // search for one blocked on this
-		while(pt->blocked != s){
-			pt = pt->next;
-		}
-		pt->blocked = 0;   // wakeup this one
+void OS_Signal(Sema4Type *s){
+	SignalAt(s, CYCLE_COUNT());
+}
+
+// converts microseconds to OS_Time counts, at most SLEEP_MAX
+static uint32_t Counts(uint32_t us){
+	return (us < SLEEP_MAX / BUS_MHZ) ? us * BUS_MHZ : SLEEP_MAX;
+}
+
+// queues the current thread in SleepQueue to wake after a number of
+// OS_Time counts. Called inside a critical section, with the thread
+// already out of the ready rings.
+static void SleepStart(uint32_t counts){
+	RunPt->Sleep = 1;
+	SleepUpdate();       // SleepQueue now counts from SleepTime = now
+	DeltaQueue_Insert(&SleepQueue, &RunPt->SleepNode, counts);
+	SleepUpdate();       // it may be the first to wake
+}
+
+// sleeps the current thread for a number of OS_Time counts, queued in
+// SleepQueue by wakeup time
+static void SleepCounts(uint32_t counts){
+	OS_CriticalEnter();
+	if(counts){
+		ReadyRemove(RunPt);
+		SleepStart(counts);
 	}
-	EnableInterrupts();
+	OS_Suspend();
+	OS_CriticalExit();
 }
 
 // ******** OS_Sleep ************
-// sleeps the current thread by setting its Sleep counter 
+// sleeps the current thread
 // input:  integer multiple of thread switching intervals
 // output: none
 void OS_Sleep(uint32_t SleepCtr){ 
-	 RunPt->Sleep=SleepCtr;
-	 OS_Suspend();
+	SleepCounts((SleepCtr < SLEEP_MAX / TimeSlice) ? SleepCtr * TimeSlice : SLEEP_MAX);
+}
+
+// ******** OS_SleepUs ************
+// sleeps the current thread, to the resolution of OS_Time. The thread
+// runs at the wakeup time if it outranks the running thread.
+// input:  microseconds
+// output: none
+void OS_SleepUs(uint32_t us){
+	SleepCounts(Counts(us));
+}
+
+// ******** OS_IdleTime ************
+// input:  none
+// output: OS_Time counts the idle thread has spent waiting for an
+//         interrupt, wraps like OS_Time. The CPU load over an interval
+//         is 1 - (change in OS_IdleTime) / (change in OS_Time).
+uint32_t OS_IdleTime(void){
+	return IdleTime;
+}
+
+// runs when no other thread is ready. WFI stops the core until an
+// interrupt is pending, which is taken once interrupts are enabled
+// again, after the time asleep is added to IdleTime. This needs PRIMASK,
+// as WFI does not wake for an interrupt masked by BASEPRI, so it is the
+// one place where the OS delays every interrupt, by a few cycles.
+static void Idle(void){
+	uint32_t start;
+	for(;;){
+		DisableInterrupts();
+		start = OS_Time();
+		__WFI();
+		IdleTime += OS_Time() - start;
+		EnableInterrupts();
+	}
 }
 
 /*Secheduler*/
-// Selects the next thread to run (unblocked, non-sleeping, modifies the sleep counter
+// Selects the next thread to run. A thread that is still ready goes to
+// the back of its ring, then Pick chooses. PendSV_Handler does the
+// switch once no other interrupt is active.
+// Called from SysTick_Handler and OS_Suspend inside a critical section.
 // input: none
 // output: none
 void Scheduler(void){
+#if OS_AGING
 	tcbType *pt;
-	pt=RunPt;
+	uint32_t i;
 	if (NVIC_ST_CTRL_R & 0x10000){  // full thread time has passed
-		while (pt->next != RunPt){
-			pt=pt->next;
-			if (pt->Sleep){
-				pt->Sleep=(pt->Sleep)-1;
+		for (i = 0; i < NumThreads; i++){
+			pt = &tcbs[i];
+			if ((pt != RunPt) && (pt != IdlePt) && (pt->blocked == 0) && (pt->locking == 0) && (pt->Sleep == 0) && (++pt->Age >= AGE_LIMIT)){
+				pt->Age = 0;
+				if (pt->WorkingPriority > 0){
+					ReadyRemove(pt);
+					pt->WorkingPriority--;
+					ReadyInsert(pt);
+				}
 			}
 		}
 	}
-	RunPt = RunPt->next;     // skip at least one
-	while((RunPt->Sleep)||(RunPt-> blocked)){
-		RunPt = RunPt->next;   // find one not sleeping and not blocked
+#endif
+	if ((RunPt->blocked == 0) && (RunPt->locking == 0) && (RunPt->Sleep == 0)){
+#if OS_AGING
+		if (RunPt->WorkingPriority != BasePriority(RunPt)){
+			ReadyRemove(RunPt);
+			RunPt->WorkingPriority = BasePriority(RunPt);
+			ReadyInsert(RunPt);
+		} else
+#endif
+		ReadyList[RunPt->WorkingPriority] = RunPt->next; // round robin
 	}
+	Pick();
 }
 
-
 void SendMail(int32_t data){
   Mail=data;
-	if(Send){
+	if(Send.Value){
 		Lost_mailbox++;
 	}
 	else{
@@ -139,9 +613,123 @@ int32_t RecvMail(void){
 }
 
 // OS_InitSmeaphore
-// Initializes a semaphore
-void OS_InitSemaphore(int32_t *Sem, int32_t val){
-	*Sem=val;
+// Initializes a semaphore, which must have no waiters
+// input:  semaphore pointer, initial value,
+//         WQ_PRIORITY or WQ_FIFO order of wakeup
+void OS_InitSemaphore(Sema4Type *Sem, int32_t val, uint32_t policy){
+	Sem->Value=val;
+	WaitQueue_Init(&Sem->Waiters, policy);
+}
+
+// ******** OS_InitMutex ************
+// initializes a mutex as free, with its statistics cleared
+// input:  mutex pointer
+// output: none
+void OS_InitMutex(MutexType *m){
+	m->Owner = 0;
+	m->NextHeld = 0;
+	WaitQueue_Init(&m->Waiters, WQ_PRIORITY);
+	CycleStats_Reset(&m->Hold);
+	m->Contended = 0;
+	m->Timeouts = 0;
+	m->Recursions = 0;
+}
+
+// makes a thread the owner of a free mutex.
+// Called inside a critical section.
+static void Take(MutexType *m, tcbType *t){
+	m->Owner = t;
+	m->NextHeld = t->held;
+	t->held = m;
+	m->LockedAt = CYCLE_COUNT();
+}
+
+// locks a mutex for the current thread, waiting for at most a number of
+// OS_Time counts if timed
+static int Lock(MutexType *m, uint32_t counts, int timed){
+	tcbType *me = RunPt;
+	OS_CriticalEnter();
+	if(OWNER(m) == me){
+		m->Recursions++;
+		OS_CriticalExit();
+		return OS_MUTEX_RECURSIVE;
+	}
+	if(m->Owner == 0){
+		Take(m, me);
+		OS_CriticalExit();
+		return OS_MUTEX_OK;
+	}
+	m->Contended++;
+	if(timed && (counts == 0)){
+		m->Timeouts++;
+		OS_CriticalExit();
+		return OS_MUTEX_TIMEOUT;
+	}
+	me->locking = m;
+	ReadyRemove(me);
+	WaitQueue_Put(&m->Waiters, &me->WaitNode, me->WorkingPriority);
+	if(timed){
+		SleepStart(counts);
+	}
+	Inherit(OWNER(m));   // the owner runs at least at this priority
+	OS_Suspend();        // PendSV switches once the section ends
+	OS_CriticalExit();
+	return (OWNER(m) == me) ? OS_MUTEX_OK : OS_MUTEX_TIMEOUT;
+}
+
+// ******** OS_Lock ************
+// locks a mutex, waiting as long as another thread holds it
+// input:  mutex pointer
+// output: OS_MUTEX_OK, or OS_MUTEX_RECURSIVE if the caller holds it
+int OS_Lock(MutexType *m){
+	return Lock(m, 0, 0);
+}
+
+// ******** OS_LockTimeout ************
+// locks a mutex, waiting at most the given time, to the resolution of
+// OS_Time. A time of 0 only tries.
+// input:  mutex pointer, microseconds
+// output: OS_MUTEX_OK, OS_MUTEX_TIMEOUT, or OS_MUTEX_RECURSIVE if the
+//         caller holds it
+int OS_LockTimeout(MutexType *m, uint32_t us){
+	return Lock(m, Counts(us), 1);
+}
+
+// ******** OS_Unlock ************
+// unlocks a mutex held by the current thread. The thread drops the
+// priority it inherited through the mutex, and the highest priority
+// waiter becomes the owner.
+// input:  mutex pointer
+// output: OS_MUTEX_OK, or OS_MUTEX_NOT_OWNER if the caller does not hold it
+int OS_Unlock(MutexType *m){
+	MutexType **pp;
+	WQ_Node *n;
+	tcbType *t;
+	OS_CriticalEnter();
+	if(OWNER(m) != RunPt){
+		OS_CriticalExit();
+		return OS_MUTEX_NOT_OWNER;
+	}
+	CycleStats_Add(&m->Hold, m->LockedAt);
+	for(pp = &RunPt->held; *pp != m; pp = &(*pp)->NextHeld){
+	}
+	*pp = m->NextHeld;
+	m->Owner = 0;
+	Inherit(RunPt);              // gives back what came through m
+	n = WaitQueue_Get(&m->Waiters);
+	if(n){
+		t = WAITER(n);
+		t->locking = 0;
+		if(t->Sleep){              // a timed lock
+			DeltaQueue_Remove(&SleepQueue, &t->SleepNode);
+			t->Sleep = 0;
+		}
+		Take(m, t);
+		t->WorkingPriority = BasePriority(t); // for the waiters left
+		Wakeup(t, CYCLE_COUNT());
+	}
+	OS_CriticalExit();
+	return OS_MUTEX_OK;
 }
 
 // ******** OS_Init ************
@@ -154,50 +742,140 @@ void OS_Init(void){
   Clock_Init();                 // set processor clock to 16 MHz
   NVIC_ST_CTRL_R = 0;         // disable SysTick during setup
   NVIC_ST_CURRENT_R = 0;      // any write to current clears it
-  NVIC_SYS_PRI3_R =(NVIC_SYS_PRI3_R&0x00FFFFFF)|0xE0000000; // priority 7
+  NVIC_SYS_PRI3_R =(NVIC_SYS_PRI3_R&0x00FFFFFF)|0xE0000000; // SysTick priority 7
+  NVIC_SYS_PRI3_R =(NVIC_SYS_PRI3_R&0xFF00FFFF)|0x00E00000; // PendSV priority 7
+  NVIC_CPAC_R |= 0x00F00000;    // full access to the FPU (CP10, CP11)
+  SYSCTL_RCGCTIMER_R |= 0x02;   // activate timer1 for OS_Time
+  while ((SYSCTL_PRTIMER_R & 0x02) == 0) {};
+  TIMER1_CTL_R = 0;             // disable timer1A during setup
+  TIMER1_CFG_R = 0;             // 32-bit mode
+  TIMER1_TAMR_R = 0x00000032;   // periodic, count up, match interrupt
+  TIMER1_TAILR_R = 0xFFFFFFFF;  // free running
+  TIMER1_IMR_R = 0;             // SleepUpdate arms the match
+  TIMER1_ICR_R = 0x1F;
+  NVIC_PRI5_R = (NVIC_PRI5_R&0xFFFF00FF)|0x0000E000; // priority 7, like SysTick
+  NVIC_EN0_R = 1 << 21;         // enable interrupt 21 in NVIC
+  TIMER1_CTL_R = 0x00000001;    // timer1A counts from 0
+  DeltaQueue_Init(&SleepQueue);
+  SleepTime = 0;
+  IdlePt = AddThread(Idle, IDLE_STACK, IDLE_PRIORITY, "idle");
 }
 
-void SetInitialStack(int i){
-  tcbs[i].sp = &Stacks[i][STACKSIZE-16]; // thread stack pointer
-  Stacks[i][STACKSIZE-1] = 0x01000000;   // thumb bit
-  Stacks[i][STACKSIZE-3] = 0x14141414;   // R14
-  Stacks[i][STACKSIZE-4] = 0x12121212;   // R12
-  Stacks[i][STACKSIZE-5] = 0x03030303;   // R3
-  Stacks[i][STACKSIZE-6] = 0x02020202;   // R2
-  Stacks[i][STACKSIZE-7] = 0x01010101;   // R1
-  Stacks[i][STACKSIZE-8] = 0x00000000;   // R0
-  Stacks[i][STACKSIZE-9] = 0x11111111;   // R11
-  Stacks[i][STACKSIZE-10] = 0x10101010;  // R10
-  Stacks[i][STACKSIZE-11] = 0x09090909;  // R9
-  Stacks[i][STACKSIZE-12] = 0x08080808;  // R8
-  Stacks[i][STACKSIZE-13] = 0x07070707;  // R7
-  Stacks[i][STACKSIZE-14] = 0x06060606;  // R6
-  Stacks[i][STACKSIZE-15] = 0x05050505;  // R5
-  Stacks[i][STACKSIZE-16] = 0x04040404;  // R4
+// Paints the stack of thread t and builds the frame that StartOS or the
+// first switch to it pops
+static void SetInitialStack(tcbType *t, void(*task)(void)){
+  int32_t *top = t->stack + t->StackWords;
+  uint32_t i;
+  for(i = 0; i < t->StackWords; i++){
+    t->stack[i] = STACK_PAINT;
+  }
+  t->sp = top - 17;         // thread stack pointer
+  top[-1] = 0x01000000;     // thumb bit
+  top[-2] = (int32_t)task;  // PC
+  top[-3] = 0x14141414;     // R14
+  top[-4] = 0x12121212;     // R12
+  top[-5] = 0x03030303;     // R3
+  top[-6] = 0x02020202;     // R2
+  top[-7] = 0x01010101;     // R1
+  top[-8] = 0x00000000;     // R0
+  top[-9] = 0xFFFFFFF9;     // EXC_RETURN, thread mode on MSP, no FPU state
+  top[-10] = 0x11111111;    // R11
+  top[-11] = 0x10101010;    // R10
+  top[-12] = 0x09090909;    // R9
+  top[-13] = 0x08080808;    // R8
+  top[-14] = 0x07070707;    // R7
+  top[-15] = 0x06060606;    // R6
+  top[-16] = 0x05050505;    // R5
+  top[-17] = 0x04040404;    // R4
 }
 
-
-
+// adds a thread for OS_AddThread or the idle thread for OS_Init
+// output: its TCB, 0 if there is no room for it
+static tcbType *AddThread(void(*task)(void), uint32_t stackWords, uint32_t priority, const char *name){
+  tcbType *t;
+  stackWords = (stackWords + 1) & ~1u; // keep every stack 8-byte aligned
+  OS_CriticalEnter();
+  if((NumThreads >= NUMTHREADS) || (stackWords < MIN_STACK) || (priority >= NUM_PRIORITIES) ||
+     (StackPoolUsed + stackWords > STACK_POOL_WORDS)){
+    OS_CriticalExit();
+    return 0;
+  }
+  t = &tcbs[NumThreads];
+  t->stack = &StackPool[StackPoolUsed];
+  t->StackWords = stackWords;
+  StackPoolUsed += stackWords;
+  t->name = name;
+  t->blocked = 0;
+  t->locking = 0;
+  t->held = 0;
+  t->Sleep = 0;
+  t->FixedPriority = priority;
+  t->WorkingPriority = priority;
+  t->Age = 0;
+  t->Handoff = 0;
+  SetInitialStack(t, task);
+  if(RunPt){
+    Wakeup(t, CYCLE_COUNT()); // added by a running thread
+  } else{
+    ReadyInsert(t);
+  }
+  NumThreads++;
+  OS_CriticalExit();
+  return t;
+}
 
 //******** OS_AddThread ***************
-// add three foregound threads to the scheduler
-// Inputs: pointers to a void/void foreground tasks
+// adds a foreground thread, with its stack taken from StackPool. Threads
+// of equal priority take turns in the order they were added. Can be
+// called after OS_Launch.
+// Inputs: pointer to a void/void foreground task
+//         stack size in 32-bit words, at least MIN_STACK
+//         priority, 0 is the highest, below IDLE_PRIORITY
+//         name, kept for debugging
 // Outputs: 1 if successful, 0 if this thread can not be added
+int OS_AddThread(void(*task)(void), uint32_t stackWords, uint32_t priority, const char *name){
+  if(priority >= IDLE_PRIORITY){
+    return 0;
+  }
+  return AddThread(task, stackWords, priority, name) != 0;
+}
 
+//******** OS_AddThreads ***************
+// add four foregound threads to the scheduler, each with STACKSIZE
+// words of stack and the same priority, so they run round robin
+// Inputs: pointers to a void/void foreground tasks
+// Outputs: 1 if successful, 0 if this thread can not be added
 int OS_AddThreads(void(*task0)(void),
                  void(*task1)(void),
-                 void(*task2)(void) )
-                                { int32_t status;
-  status = StartCritical();
-  tcbs[0].next = &tcbs[1]; // 0 points to 1
-  tcbs[1].next = &tcbs[2]; // 1 points to 2
-  tcbs[2].next = &tcbs[0]; // 2 points to 0
-  SetInitialStack(0); Stacks[0][STACKSIZE-2] = (int32_t)(task0); // PC
-  SetInitialStack(1); Stacks[1][STACKSIZE-2] = (int32_t)(task1); // PC
-  SetInitialStack(2); Stacks[2][STACKSIZE-2] = (int32_t)(task2); // PC
-  RunPt = &tcbs[0];       // thread 0 will run first
-  EndCritical(status);
-  return 1;               // successful
+                 void(*task2)(void),
+                 void(*task3)(void) ){
+  return OS_AddThread(task0, STACKSIZE, 0, "task0") &&
+         OS_AddThread(task1, STACKSIZE, 0, "task1") &&
+         OS_AddThread(task2, STACKSIZE, 0, "task2") &&
+         OS_AddThread(task3, STACKSIZE, 0, "task3");
+}
+
+//******** OS_GetThreadInfo ***************
+// reports a thread's name, priority and stack use. The peak stack use
+// is found from how much of the paint laid down by OS_AddThread has
+// been overwritten.
+// Inputs: thread number, in the order added, and where to store the info
+// Outputs: 1 if successful, 0 if there is no such thread
+int OS_GetThreadInfo(uint32_t id, OS_ThreadInfo *info){
+  tcbType *t;
+  uint32_t unused = 0;
+  if(id >= NumThreads){
+    return 0;
+  }
+  t = &tcbs[id];
+  while((unused < t->StackWords) && (t->stack[unused] == (int32_t)STACK_PAINT)){
+    unused++;               // stacks grow down, the paint is left at the bottom
+  }
+  info->name = t->name;
+  info->priority = t->FixedPriority;
+  info->stackWords = t->StackWords;
+  info->stackUsed = t->StackWords - unused;
+  return 1;
 }
 
 ///******** OS_Launch ***************
@@ -206,6 +884,9 @@ int OS_AddThreads(void(*task0)(void),
 //         (maximum of 24 bits)
 // Outputs: none (does not return)
 void OS_Launch(uint32_t theTimeSlice){
+  TimeSlice = theTimeSlice;
+  RunPt = ReadyList[__CLZ(ReadyBits)]; // highest priority runs first
+  NextPt = RunPt;
   NVIC_ST_RELOAD_R = theTimeSlice - 1; // reload value
   NVIC_ST_CTRL_R = 0x00000007; // enable, core clock and interrupt arm
   StartOS();                   // start on the first task
@@ -23,18 +23,22 @@
 ; http://users.ece.utexas.edu/~valvano/
 ; */
 
-		IMPORT	Scheduler
+		IMPORT	OS_SwitchDone
+		IMPORT	OS_RunDeferred
 	AREA |.text|, CODE, READONLY, ALIGN=2
         THUMB
         REQUIRE8
         PRESERVE8
 
         EXTERN  RunPt            ; currently running thread
+        EXTERN  NextPt           ; thread to switch to, set by the scheduler
         EXPORT  OS_DisableInterrupts
         EXPORT  OS_EnableInterrupts
         EXPORT  StartOS
-        EXPORT  SysTick_Handler
+        EXPORT  PendSV_Handler
 
+DWT_CYCCNT  EQU     0xE0001004   ; cycle counter, started by CycleCount_Init
+KERNEL_BASEPRI EQU  0x60         ; OS_KERNEL_PRIORITY << 5, see os.h
 
 
 OS_DisableInterrupts
@@ -47,26 +51,61 @@ OS_EnableInterrupts
         BX      LR
 
 
-SysTick_Handler                ; 1) Saves R0-R3,R12,LR,PC,PSR
-    CPSID   I                  ; 2) Prevent interrupt during switch
-    PUSH    {R4-R11}           ; 3) Save remaining regs r4-11
-    LDR     R0, =RunPt         ; 4) R0=pointer to RunPt, old thread
+; Switches from RunPt to NextPt. Runs at the lowest priority, so it only
+; runs once no other interrupt is active and no critical section is
+; open. It first does the signals queued by OS_SignalDeferred, which may
+; change NextPt. The switch masks only the interrupts that may call the
+; OS, through BASEPRI, so the others can still run on the old or the
+; new thread's stack.
+; Each thread's stack holds, from the top: the hardware frame, S16-S31
+; if the thread uses the FPU, then R4-R11 and its EXC_RETURN. Bit 4 of
+; EXC_RETURN is clear when the hardware frame is the extended one with
+; S0-S15 reserved, so only threads that have executed FPU instructions
+; save S16-S31. S0-S15 are stacked lazily by the hardware, if the VPUSH
+; below is the first FPU instruction since the exception.
+PendSV_Handler                 ; 1) Saves R0-R3,R12,LR,PC,PSR (and S0-S15, FPSCR)
+    PUSH    {R0, LR}
+    BL      OS_RunDeferred     ; 2) Signals from interrupts above the OS
+    POP     {R0, LR}
+    MOV     R0, #KERNEL_BASEPRI
+    MSR     BASEPRI, R0        ; 3) Prevent OS interrupts during switch
+    LDR     R0, =RunPt
     LDR     R1, [R0]           ;    R1 = RunPt
-    STR     SP, [R1]           ; 5) Save SP into TCB
-	PUSH	{LR, R0}
-	BL		Scheduler		   ; 6) Call Scheduler
-	POP		{LR, R0}		   
-    LDR		R1, [R0]
-	LDR     SP, [R1]           ; 7) new thread SP; SP = RunPt->sp;
-    POP     {R4-R11}           ; 8) restore regs r4-11
-    CPSIE   I                  ; 9) tasks run with interrupts enabled
-    BX      LR                 ; 10) restore R0-R3,R12,LR,PC,PSR
+    LDR     R2, =NextPt
+    LDR     R2, [R2]           ;    R2 = NextPt
+    CMP     R1, R2
+    BEQ     PendSV_Done        ;    nothing to switch
+    LDR     R3, =DWT_CYCCNT
+    LDR     R12, [R3]          ;    R12 = start of the switch
+    MOV     R3, LR             ;    R3 = EXC_RETURN of the old thread
+    TST     LR, #0x10          ; 4) Save S16-S31 if the thread uses the FPU
+    IT      EQ
+    VPUSHEQ {S16-S31}
+    PUSH    {R4-R11, LR}       ; 5) Save remaining regs r4-11 and EXC_RETURN
+    STR     SP, [R1]           ; 6) Save SP into TCB
+    STR     R2, [R0]           ; 7) RunPt = NextPt, new thread
+    LDR     SP, [R2]           ; 8) new thread SP; SP = RunPt->sp;
+    POP     {R4-R11, LR}       ; 9) restore regs r4-11 and EXC_RETURN
+    TST     LR, #0x10          ; 10) Restore S16-S31 if it uses the FPU
+    IT      EQ
+    VPOPEQ  {S16-S31}
+    MOV     R0, R12            ; 11) OS_SwitchDone(start, old, new EXC_RETURN)
+    MOV     R1, R3
+    MOV     R2, LR
+    PUSH    {R0, LR}
+    BL      OS_SwitchDone
+    POP     {R0, LR}
+PendSV_Done
+    MOV     R0, #0
+    MSR     BASEPRI, R0        ; 12) tasks run with interrupts enabled
+    BX      LR                 ; 13) restore R0-R3,R12,LR,PC,PSR
 
 StartOS
     LDR     R0, =RunPt         ; currently running thread
     LDR     R2, [R0]           ; R2 = value of RunPt
     LDR     SP, [R2]           ; new thread SP; SP = RunPt->stackPointer;
     POP     {R4-R11}           ; restore regs r4-11
+    POP     {R0}               ; discard EXC_RETURN, the thread starts without FPU state
     POP     {R0-R3}            ; restore regs r0-3
     POP     {R12}
     POP     {LR}               ; discard LR from initial stack
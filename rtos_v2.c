@@ -28,21 +28,33 @@
 #include "LCD_Logic.h"
 #include <math.h>
 #include "PWM.h"
+#include "PID.h"
+#include "Speed_Control.h"
+#include "Cycle_Count.h"
+#include "Voltage2RPM.h"
+#include "Encoder.h"
+#include "Recorder.h"
+#include "os.h"
 
 #define TIMESLICE               32000  // thread switch time in system time units
 																			// clock frequency is 16 MHz, switching time is 2ms
+#define LCD_WAIT_US             100000 // LCD_Bottom skips a refresh after waiting this long for sLCD
 
 uint32_t Switches_in;
 uint32_t Switches_use;
 uint32_t prev_button;
 // variables for controller
 uint32_t N = 0;
+PID_Type SpeedPID;
+CycleStats ControllerCycles; // execution time of one control iteration
+CycleStats ControlPeriod;    // time between control loop releases, max - min is the jitter
+CycleStats ControlLatency;   // time from the release in ADC_Process until Controller runs
 // end of controller variables
 
 uint8_t Key_ASCII; // contain value returned by Scan_Keypad
 uint32_t button_pressed = 0x00;
 uint32_t clear_top = 0x00;
-int32_t sLCD = 1; // LCD Semaphore
+MutexType sLCD; // LCD and keypad scan, which share Port A
 int32_t key_rpm_pos = 0x0B;
 int32_t counter = 0;
 int32_t key_rpm = 0;
@@ -50,20 +62,15 @@ int32_t des_rpm = 0;
 int32_t cur_rpm = 0;
 int32_t test = 0;
 
-void OS_Init(void);
-void OS_AddThreads(void f1(void), void f2(void), void f3(void));
-void OS_Launch(uint32_t);
-void OS_Sleep(uint32_t SleepCtr);
 void OS_Fifo_Put(uint32_t data);
 uint32_t OS_Fifo_Get(void);
 uint32_t OS_Fifo_Peek(void);
-void OS_InitSemaphore(int32_t *S, int val);
-void OS_Wait(int32_t *S);
-void OS_Signal(int32_t *S);
 int32_t get_size(void);
 
 void OS_DisableInterrupts(void); // Disable interrupts
 void OS_EnableInterrupts(void);  // Enable interrupts
+void DisableInterrupts(void);    // in startup_TM4C123.s
+void EnableInterrupts(void);
 
 // function definitions in LCD.s
 void Display_Msg(char* msg); // Disable interrupts
@@ -83,12 +90,6 @@ void Init_Keypad(void);
 void Read_Key(void);
 void Delay1ms(void);
 
-// helper function for voltage to speed
-int32_t Current_speed(int32_t Avg_volt){ // This function returns the current
-                                           // DC motor RPM given the voltage in mV
-  if (Avg_volt<= 1200) {return 0;}
-  else {return ((21408*Avg_volt)>>16)-225;}
-}
 
 uint32_t duty_cycle;
 
@@ -103,20 +104,53 @@ void DCMotor(uint32_t scaled_fuzzy) {
 }
 
 // PID controller
+// Runs once per release from ADC_Process (control_rate times per second)
+// and blocks on sControl in between.
 void Controller(void) {
-	uint32_t temp_controller;
-	double kF = 500;
-	double kP = 0.75;
+	uint32_t start;
+	uint32_t last_release;
+#if RECORDER
+	int32_t recorded_rpm = -1;
+#endif
+	Speed_Control_Init(&SpeedPID);
+	CycleStats_Reset(&ControllerCycles);
+	CycleStats_Reset(&ControlPeriod);
+	CycleStats_Reset(&ControlLatency);
+	OS_Wait(&sControl);
+	last_release = CYCLE_COUNT();
 	while(1) {
+		OS_Wait(&sControl); // missed releases are counted in control_deadline_misses
+		start = CYCLE_COUNT();
+		CycleStats_Add(&ControlLatency, control_release_time);
+		CycleStats_Add(&ControlPeriod, last_release);
+		last_release = start;
+		
+#if RECORDER
+		// ADC_Process and Keypad must not run until the iteration is
+		// recorded, so a replay sees the same samples and setpoint. Only
+		// the OS is held off, the ADC interrupts keep capturing.
+		OS_CriticalEnter();
+		if (des_rpm != recorded_rpm) {
+			recorded_rpm = des_rpm;
+			Recorder_Put(REC_SETPOINT, des_rpm);
+		}
+		Recorder_Put(REC_CONTROL, processed_samples & 0xFFF);
+#endif
+#if SPEED_ENCODER
+		cur_rpm = Encoder_Speed();
+#elif SPEED_OBSERVER
+		cur_rpm = Observer_Speed(&speed_observer);
+#else
 		cur_rpm = Current_speed(average_millivolts);
-		N = kP*(des_rpm-cur_rpm) + kF;
-		if(N >= 2500)
-			N = 2500;
-		else if(N <= 0 || des_rpm == 0)
-			N = 0;
-		else if(des_rpm < kF)
-			N = N - kF;
+#endif
+		N = Speed_Control_Step(&SpeedPID, des_rpm, cur_rpm);
 		DCMotor(N); // update motor here
+#if RECORDER
+		Recorder_Put(REC_SPEED, cur_rpm);
+		Recorder_Put(REC_DUTY, N);
+		OS_CriticalExit();
+#endif
+		CycleStats_Add(&ControllerCycles, start);
 	}
 }
 
@@ -124,18 +158,21 @@ void Controller(void) {
 // End of fuzzy logic
 
 void Keypad(void) {
-	OS_Wait(&sLCD);
+	OS_Lock(&sLCD);
 	Set_Position(0x00);
 	Display_Msg("Input RPM:");
-	OS_Signal(&sLCD);
+	OS_Unlock(&sLCD);
 	
 	for(;;){
 		// output keypad to top of LCD
-		OS_Wait(&sLCD);
+		OS_Lock(&sLCD); // held until a key is pressed, see sLCD.Hold
 		Set_Position(key_rpm_pos + counter);
 		// display keypad number
 		
 		Read_Key();
+#if RECORDER
+		Recorder_Put(REC_KEY, Key_ASCII);
+#endif
 		
 		if(Key_ASCII == 0x23 || counter >= 4)
 		{
@@ -155,13 +192,15 @@ void Keypad(void) {
 			key_rpm = (Key_ASCII - 0x30) * pow(10, 3-counter) + key_rpm; // start from thousandths then go to ones
 			counter = counter + 1; // TODO - set this in terms of keypad
 		}
-		OS_Signal(&sLCD);
+		OS_Unlock(&sLCD);
 	} 
 }
 
 void LCD_Bottom(void) {
 	for(;;) {
-		OS_Wait(&sLCD);
+		if(OS_LockTimeout(&sLCD, LCD_WAIT_US) != OS_MUTEX_OK){
+			continue; // counted in sLCD.Timeouts
+		}
 		// display input rpm
 		// next line display target and current rpm
 		
@@ -176,22 +215,34 @@ void LCD_Bottom(void) {
 		DisplayOrNot((cur_rpm / 100) % 10);
 		DisplayOrNot((cur_rpm / 10) % 10);
 		Display_Char((char) (cur_rpm % 10 + 0x30));
-		OS_Signal(&sLCD);
+		OS_Unlock(&sLCD);
 	}
 }
 
 int main(void){
 	DisableInterrupts();
   OS_Init();           // initialize, disable interrupts, 16 MHz
-	OS_InitSemaphore(&sLCD, 1); // sLCD is initially 1
+	OS_InitMutex(&sLCD);
 	Clock_Init();
+	CycleCount_Init();
 	Init_LCD_Ports();
 	Init_LCD();
 	Init_Keypad();
 	PWM_setup();
+#if RECORDER
+	Recorder_Init(pwm_duty); // before Init_ADC, which records the rate
+#endif
 	Init_ADC();
+#if SPEED_ENCODER
+	Encoder_Init(control_rate); // set by Init_ADC
+#endif
 	
-  OS_AddThreads(&Keypad, &LCD_Bottom, &Controller);
+	// stack sizes in words, check them with OS_GetThreadInfo.
+	// Priority 0 is the highest.
+	OS_AddThread(&Keypad, 192, 2, "Keypad"); // pow() needs the extra stack, and may use the FPU
+	OS_AddThread(&LCD_Bottom, 100, 2, "LCD_Bottom");
+	OS_AddThread(&Controller, 128, 1, "Controller");
+	OS_AddThread(&ADC_Process, 128, 0, "ADC_Process");
   EnableInterrupts();
 		
 	OS_Launch(TIMESLICE); // doesn't return, interrupts enabled in here
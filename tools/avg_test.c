@@ -0,0 +1,80 @@
+// avg_test.c
+// Host tool, not part of the Keil project.
+// Checks the sliding-window average in Sample_Process.c against a naive
+// average that sums the last AVG_WINDOW millivolt values on every
+// sample. Random codes are fed through Sample_Process with the filter
+// stages as configured in Sample_Process.h, and after every sample
+// average_millivolts must equal the naive average. Sample_Process is
+// restarted part way through to check that a restart clears the window.
+//
+// Build:  gcc -O2 -I. -o avg_test tools/avg_test.c Sample_Process.c
+//             Filter.c Observer.c Voltage2RPM.c
+//         Add -DADC_12BIT=1 or -DADC_PWM_SYNC=1 to check the other
+//         window lengths.
+// Usage:  avg_test
+//
+// Prints the window length and the number of samples checked. The exit
+// status is 1 at the first sample where the two averages differ.
+
+#include <stdio.h>
+#include <stdint.h>
+#include "Sample_Process.h"
+
+#define SAMPLES	1000000
+#define RESTART	(SAMPLES / 2)
+
+static int32_t history[AVG_WINDOW]; // last AVG_WINDOW millivolt values, oldest first
+static uint32_t seed = 1;
+
+static int32_t Random_Code(void) {
+	seed = seed * 1664525 + 1013904223;
+	return (int32_t)(seed >> 20);   // 12-bit code
+}
+
+// the window after a restart holds zeros, as sample_window does
+static void Naive_Init(void) {
+	uint32_t i;
+	for (i = 0; i < AVG_WINDOW; i++) {
+		history[i] = 0;
+	}
+}
+
+static int32_t Naive_Average(int32_t millivolts) {
+	int32_t sum = 0;
+	uint32_t i;
+	for (i = 0; i + 1 < AVG_WINDOW; i++) {
+		history[i] = history[i + 1];
+		sum += history[i];
+	}
+	history[AVG_WINDOW - 1] = millivolts;
+	sum += millivolts;
+	return sum >> AVG_WINDOW_SHIFT; // same rounding as the firmware
+}
+
+int main(void) {
+	uint32_t i;
+	int32_t code, naive;
+
+	if (FILTER_MEDIAN_N || FILTER_CIC_SHIFT || FILTER_FIR || FILTER_BIQUAD) {
+		fprintf(stderr, "turn the filter stages off in Sample_Process.h to compare the average alone\n");
+		return 1;
+	}
+	Sample_Process_Init(10000);
+	Naive_Init();
+	for (i = 0; i < SAMPLES; i++) {
+		if (i == RESTART) {
+			Sample_Process_Init(10000);
+			Naive_Init();
+		}
+		code = Random_Code();
+		Sample_Process(code, 0);
+		naive = Naive_Average(Sample_to_Millivolts(code));
+		if (average_millivolts != naive) {
+			fprintf(stderr, "sample %u (code %d): average %d, naive %d\n",
+				i, code, average_millivolts, naive);
+			return 1;
+		}
+	}
+	printf("window %d, %u samples match\n", AVG_WINDOW, SAMPLES);
+	return 0;
+}
@@ -0,0 +1,128 @@
+// encoder_test.c
+// Host tool, not part of the Keil project.
+// Drives Encoder.c with a simulated quadrature encoder. The generator
+// advances QEI0_POS by the edges the shaft passes, and latches the edges
+// of every velocity window into QEI0_SPEED, as the QEI does. Encoder_Speed
+// is called at the control rate, as Controller() does.
+//   hold   the shaft at every speed from 400 to 2400 RPM in 100 RPM steps;
+//          the error of the estimate after it settles, and whether
+//          Encoder_Speed counted from the position register or used the
+//          velocity capture
+//   step   speed steps within and across the two methods; the latency
+//          until the estimate is halfway to the new speed
+// The position starts just below the 32-bit wrap, so every case counts
+// through it.
+//
+// Build:  gcc -O2 -I. -Itools/host -o encoder_test tools/encoder_test.c
+//             Encoder.c tools/host/registers.c
+// Usage:  encoder_test > report.csv
+//
+// The report has CSV lines "rpm,mode,mean_error_rpm,max_error_rpm" and
+// "from_rpm,to_rpm,latency_ms". The exit status is 1 if a mean error is
+// over 1% of the speed, a maximum error is over what one edge more or
+// less would give, or a latency is over two velocity windows.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <math.h>
+#include "Encoder.h"
+#include "TM4C123GH6PM.h"
+
+#define CONTROL_HZ	1000   // CONTROL_RATE in ADC.h
+#define SIM_STEP_US	5      // generator time step, under the 62.5 us between edges at 2400 RPM
+#define VEL_OFFSET_US	370    // the velocity windows do not line up with the control periods
+#define HOLD_MS	2000
+#define SETTLE_MS	500
+#define POS_START	0xFFFFF000u
+
+extern uint32_t encoder_slow_mode;
+
+static double shaft_edges;         // edges passed since POS_START, fractional
+static uint32_t window_start;      // QEI0_POS at the start of the velocity window
+static uint32_t now_us;
+
+// advances the shaft at rpm for one control period, then runs the
+// estimator as the control loop would
+static int32_t Control_Period(double rpm) {
+	uint32_t step;
+	for (step = 0; step < 1000000 / CONTROL_HZ / SIM_STEP_US; step++) {
+		now_us += SIM_STEP_US;
+		shaft_edges += rpm / 60 * ENCODER_CPR * SIM_STEP_US / 1e6;
+		QEI0_POS_R = POS_START + (uint32_t)floor(shaft_edges);
+		if ((now_us + VEL_OFFSET_US) % (1000000 / ENCODER_VEL_RATE) == 0) {
+			QEI0_SPEED_R = QEI0_POS_R - window_start;
+			window_start = QEI0_POS_R;
+		}
+	}
+	return Encoder_Speed();
+}
+
+static void Start(void) {
+	shaft_edges = 0.37;            // any phase between edges
+	now_us = 0;
+	window_start = POS_START;
+	Encoder_Init(CONTROL_HZ);
+	QEI0_SPEED_R = 0;
+}
+
+// the estimate may be off by one edge in the window it was made from
+static double Edge_Bound(int slow_mode) {
+	if (slow_mode) {
+		return 60.0 * 1000 / (ENCODER_CPR * ENCODER_SLOW_MS);
+	}
+	return 60.0 * ENCODER_VEL_RATE / ENCODER_CPR;
+}
+
+int main(void) {
+	static const int32_t steps[][2] = {
+		{400, 800}, {800, 400}, {1200, 2400}, {2400, 1200},
+		{400, 2400}, {2400, 400}, {1000, 1100},
+	};
+	int32_t rpm, est;
+	int k, mode, fail = 0;
+	unsigned s;
+
+	printf("rpm,mode,mean_error_rpm,max_error_rpm\n");
+	for (rpm = 400; rpm <= 2400; rpm += 100) {
+		double sum = 0, max = 0;
+		int n = 0;
+		Start();
+		for (k = 0; k < HOLD_MS; k++) {
+			est = Control_Period(rpm);
+			if (k >= SETTLE_MS) {
+				sum += est - rpm;
+				if (abs(est - rpm) > max) max = abs(est - rpm);
+				n++;
+			}
+		}
+		mode = encoder_slow_mode;
+		printf("%d,%s,%.2f,%.0f\n", rpm, mode ? "position" : "capture", sum / n, max);
+		if (fabs(sum / n) > rpm / 100.0 || max > Edge_Bound(mode)) {
+			fprintf(stderr, "%d RPM: mean error %.2f, max error %.0f\n", rpm, sum / n, max);
+			fail = 1;
+		}
+	}
+
+	printf("from_rpm,to_rpm,latency_ms\n");
+	for (s = 0; s < sizeof(steps) / sizeof(steps[0]); s++) {
+		int32_t from = steps[s][0], to = steps[s][1];
+		int latency = -1;
+		Start();
+		for (k = 0; k < HOLD_MS; k++) {
+			Control_Period(from);
+		}
+		for (k = 0; k < HOLD_MS && latency < 0; k++) {
+			est = Control_Period(to);
+			if ((to > from) ? (2 * est >= from + to) : (2 * est <= from + to)) {
+				latency = (k + 1) * 1000 / CONTROL_HZ;
+			}
+		}
+		printf("%d,%d,%d\n", from, to, latency);
+		if (latency < 0 || latency > 2 * 1000 / ENCODER_VEL_RATE) {
+			fprintf(stderr, "%d to %d RPM: latency %d ms\n", from, to, latency);
+			fail = 1;
+		}
+	}
+	return fail;
+}
@@ -0,0 +1,231 @@
+// filter_bench.c
+// Host tool, not part of the Keil project.
+// Checks the filter stages in Filter.c against plain reference code and
+// times them per input sample, alone and chained as Sample_Process runs
+// them. The host build has no SMLAD, so the FIR is the portable loop;
+// on the board it does two taps per multiply-accumulate.
+//
+// Build:  gcc -O2 -I. -o filter_bench tools/filter_bench.c Filter.c
+// Usage:  filter_bench > report.csv
+//
+// The report has CSV lines "stage,inputs,max_error" for the checks,
+// where max_error is in output units, then "stage,ns" for the timing.
+// The checks:
+//   fir      FIR_Step against a direct convolution of the last taps inputs
+//   biquad   Biquad_Step against the same difference equation in double
+//            precision, fed the same rounded outputs
+//   median   Median_Step against sorting a copy of the window
+//   cic      a first-order CIC_Step against the block average it equals
+// The exit status is 1 if any check is off by more than its tolerance.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <time.h>
+#include "Filter.h"
+
+#define INPUTS	200000
+#define BENCH_ROUNDS	2000000
+#define BOXCAR	100    // the boxcar GPIOC_Handler used to average over
+
+// the FIR and biquad Sample_Process uses, biquad at 10 kHz
+static const int16_t fir_coeffs[16] __attribute__((aligned(4))) = {
+	112, 243, 618, 1293, 2217, 3225, 4089, 4587,
+	4587, 4089, 3225, 2217, 1293, 618, 243, 112
+};
+#define BQ_B0	329
+#define BQ_B1	658
+#define BQ_B2	329
+#define BQ_A1	(-25576)
+#define BQ_A2	10508
+
+static int32_t input[INPUTS];
+static uint32_t seed = 1;
+
+static int32_t Random(int32_t n) {
+	seed = seed * 1664525 + 1013904223;
+	return (int32_t)((seed >> 8) % (uint32_t)n);
+}
+
+// millivolts: a slow ramp with noise and an occasional spike
+static void Make_Input(void) {
+	uint32_t i;
+	for (i = 0; i < INPUTS; i++) {
+		input[i] = (int32_t)(i % 20000) / 2 - 5000 + Random(201) - 100;
+		if (Random(1000) == 0) {
+			input[i] += Random(2) ? 4000 : -4000;
+		}
+	}
+}
+
+static double Now_ns(void) {
+	struct timespec t;
+	clock_gettime(CLOCK_MONOTONIC, &t);
+	return t.tv_sec * 1e9 + t.tv_nsec;
+}
+
+static double Check_FIR(void) {
+	FIR_Filter f;
+	int32_t out, acc;
+	uint32_t i, k;
+	double max = 0;
+
+	FIR_Init(&f, fir_coeffs, 16);
+	for (i = 0; i < INPUTS; i++) {
+		FIR_Step(&f, input[i], &out);
+		acc = 0;
+		for (k = 0; k < 16; k++) {
+			acc += (i + k >= 15) ? input[i + k - 15] * fir_coeffs[k] : 0;
+		}
+		if (abs(out - (acc >> 15)) > max) max = abs(out - (acc >> 15));
+	}
+	return max;
+}
+
+static double Check_Biquad(void) {
+	Biquad_Filter f;
+	int32_t out, x1 = 0, x2 = 0, y1 = 0, y2 = 0;
+	uint32_t i;
+	double y, e, max = 0;
+
+	Biquad_Init(&f, BQ_B0, BQ_B1, BQ_B2, BQ_A1, BQ_A2);
+	for (i = 0; i < INPUTS; i++) {
+		Biquad_Step(&f, input[i], &out);
+		y = (BQ_B0 * (double)input[i] + BQ_B1 * (double)x1 + BQ_B2 * (double)x2
+		   - BQ_A1 * (double)y1 - BQ_A2 * (double)y2) / 16384;
+		e = (y > out) ? y - out : out - y;
+		if (e > max) max = e;
+		x2 = x1;
+		x1 = input[i];
+		y2 = y1;
+		y1 = out;
+	}
+	return max;
+}
+
+static int Compare(const void *a, const void *b) {
+	int32_t x = *(const int32_t *)a, y = *(const int32_t *)b;
+	return (x > y) - (x < y);
+}
+
+static double Check_Median(uint32_t n) {
+	Median_Filter f;
+	int32_t out, sorted[MEDIAN_MAX_N];
+	uint32_t i, k;
+	double max = 0;
+
+	Median_Init(&f, n);
+	for (i = 0; i < INPUTS; i++) {
+		Median_Step(&f, input[i], &out);
+		for (k = 0; k < n; k++) {
+			sorted[k] = (i + k >= n - 1) ? input[i + k - (n - 1)] : 0;
+		}
+		qsort(sorted, n, sizeof(sorted[0]), Compare);
+		if (abs(out - sorted[n / 2]) > max) max = abs(out - sorted[n / 2]);
+	}
+	return max;
+}
+
+static double Check_CIC(uint32_t shift) {
+	CIC_Filter f;
+	int32_t out, sum = 0;
+	uint32_t i, r = 1u << shift;
+	double max = 0;
+
+	CIC_Init(&f, 1, shift);
+	for (i = 0; i < INPUTS; i++) {
+		sum += input[i];
+		if (CIC_Step(&f, input[i], &out)) {
+			if ((i + 1) % r != 0) {
+				return 1e9;             // output at the wrong phase
+			}
+			if (abs(out - (sum >> shift)) > max) max = abs(out - (sum >> shift));
+			sum = 0;
+		}
+	}
+	return max;
+}
+
+// ns per input for one stage
+#define TIME_STAGE(step, filter) do {                                      \
+	double t0 = Now_ns();                                                  \
+	for (i = 0; i < BENCH_ROUNDS; i++) {                                   \
+		if (step(filter, input[i % INPUTS], &out)) sink += out;            \
+	}                                                                      \
+	ns = (Now_ns() - t0) / BENCH_ROUNDS;                                   \
+} while (0)
+
+int main(void) {
+	FIR_Filter fir;
+	Biquad_Filter biquad;
+	Median_Filter median3, median7;
+	CIC_Filter cic;
+	static int32_t boxcar[BOXCAR];
+	volatile int32_t sink = 0;
+	int32_t out, v, box_sum = 0;
+	uint32_t i, box_pos = 0;
+	double fir_e, biquad_e, median3_e, median7_e, cic_e, ns, t0;
+	int fail;
+
+	Make_Input();
+	fir_e = Check_FIR();
+	biquad_e = Check_Biquad();
+	median3_e = Check_Median(3);
+	median7_e = Check_Median(7);
+	cic_e = Check_CIC(3);
+	printf("stage,inputs,max_error\n");
+	printf("fir,%u,%.3f\n", INPUTS, fir_e);
+	printf("biquad,%u,%.3f\n", INPUTS, biquad_e);
+	printf("median3,%u,%.3f\n", INPUTS, median3_e);
+	printf("median7,%u,%.3f\n", INPUTS, median7_e);
+	printf("cic,%u,%.3f\n", INPUTS, cic_e);
+	// the biquad output is truncated to whole units, so up to 1 off
+	fail = (fir_e != 0) || (biquad_e >= 1) || (median3_e != 0) || (median7_e != 0) || (cic_e != 0);
+
+	printf("stage,ns\n");
+	t0 = Now_ns();
+	for (i = 0; i < BENCH_ROUNDS; i++) {
+		box_sum += input[i % INPUTS] - boxcar[box_pos];
+		boxcar[box_pos] = input[i % INPUTS];
+		box_pos = (box_pos + 1 == BOXCAR) ? 0 : box_pos + 1;
+		sink += box_sum / BOXCAR;
+	}
+	printf("boxcar%u,%.1f\n", BOXCAR, (Now_ns() - t0) / BENCH_ROUNDS);
+	FIR_Init(&fir, fir_coeffs, 16);
+	TIME_STAGE(FIR_Step, &fir);
+	printf("fir16,%.1f\n", ns);
+	Biquad_Init(&biquad, BQ_B0, BQ_B1, BQ_B2, BQ_A1, BQ_A2);
+	TIME_STAGE(Biquad_Step, &biquad);
+	printf("biquad,%.1f\n", ns);
+	Median_Init(&median3, 3);
+	TIME_STAGE(Median_Step, &median3);
+	printf("median3,%.1f\n", ns);
+	Median_Init(&median7, 7);
+	TIME_STAGE(Median_Step, &median7);
+	printf("median7,%.1f\n", ns);
+	CIC_Init(&cic, 3, 2);
+	TIME_STAGE(CIC_Step, &cic);
+	printf("cic3x4,%.1f\n", ns);
+
+	// median3, CIC order 3 by 4, FIR and biquad at the decimated rate
+	Median_Init(&median3, 3);
+	CIC_Init(&cic, 3, 2);
+	FIR_Init(&fir, fir_coeffs, 16);
+	Biquad_Init(&biquad, BQ_B0, BQ_B1, BQ_B2, BQ_A1, BQ_A2);
+	t0 = Now_ns();
+	for (i = 0; i < BENCH_ROUNDS; i++) {
+		Median_Step(&median3, input[i % INPUTS], &v);
+		if (CIC_Step(&cic, v, &v)) {
+			FIR_Step(&fir, v, &v);
+			Biquad_Step(&biquad, v, &v);
+			sink += v;
+		}
+	}
+	printf("chain,%.1f\n", (Now_ns() - t0) / BENCH_ROUNDS);
+	(void)sink;
+
+	if (fail) {
+		fprintf(stderr, "a filter stage is off its reference\n");
+	}
+	return fail;
+}
@@ -0,0 +1,242 @@
+// TM4C123GH6PM.h
+// Host tool, not part of the Keil project.
+// Stand-in for the device header, so firmware modules can be built on a
+// host. Put tools/host on the include path with -Itools/host. Only what
+// those modules use is here.
+//
+// The registers are variables, defined in tools/host/registers.c. A tool
+// that links only registers.c drives them itself. The firmware
+// simulation in tools/host/tm4c.c sets host_access, which is called
+// before every access through a peripheral pointer such as GPIOC or a
+// name such as GPIO_PORTC_DATA_R, to bring the block up to the simulated
+// time: input pins, counters and interrupt status are refreshed, and the
+// writes since the last access take effect. So the interrupt clear
+// registers (GPIO ICR, TIMER ICR, PWM ISC) read as 0 here, and the
+// masked status is only in MIS, or RIS for the PWM.
+
+#ifndef TM4C123GH6PM_HOST_H
+#define TM4C123GH6PM_HOST_H
+
+#include <stdint.h>
+
+// memory barrier, also a compiler barrier
+#define __DMB()	__sync_synchronize()
+
+extern uint32_t SystemCoreClock;
+void SystemCoreClockUpdate(void);
+
+// core intrinsics, defined by tools/host/tm4c.c
+static inline uint32_t __CLZ(uint32_t x) {
+	return x ? (uint32_t)__builtin_clz(x) : 32;
+}
+void __WFI(void);
+void __enable_irq(void);
+void __set_BASEPRI(uint32_t basepri);
+uint32_t __get_IPSR(void);
+
+// tm4c123gh6pm_def.h maps the registers to the device's addresses, so
+// it is skipped.
+#define __TM4C123GH6PM_H__
+
+extern void (*host_access)(void *block);
+
+static inline void *Host_Access(void *block) {
+	if (host_access) {
+		host_access(block);
+	}
+	return block;
+}
+#define HOST_BLOCK(type, block)	((type *)Host_Access((void *)&(block)))
+
+typedef struct {
+	volatile uint32_t DATA;
+	volatile uint32_t DIR;
+	volatile uint32_t IS;
+	volatile uint32_t IBE;
+	volatile uint32_t IEV;
+	volatile uint32_t IM;
+	volatile uint32_t RIS;
+	volatile uint32_t MIS;
+	volatile uint32_t ICR;
+	volatile uint32_t AFSEL;
+	volatile uint32_t PUR;
+	volatile uint32_t DEN;
+	volatile uint32_t LOCK;
+	volatile uint32_t CR;
+	volatile uint32_t AMSEL;
+	volatile uint32_t PCTL;
+	// the bit-specific DATA addresses: a write to DATA_BITS[m] only
+	// changes the bits of m. host_access is passed the array rather
+	// than the port for these.
+	volatile uint32_t DATA_BITS[256];
+} GPIOA_Type;
+
+typedef struct {
+	volatile uint32_t RCC;
+	volatile uint32_t RCGCGPIO;
+	volatile uint32_t RCGCTIMER;
+	volatile uint32_t RCGCPWM;
+	volatile uint32_t RCGCQEI;
+	volatile uint32_t PRGPIO;   // read back all peripherals ready
+	volatile uint32_t PRTIMER;
+	volatile uint32_t PRQEI;
+} SYSCTL_Type;
+
+typedef struct {
+	volatile uint32_t CFG;
+	volatile uint32_t TAMR;
+	volatile uint32_t CTL;
+	volatile uint32_t IMR;
+	volatile uint32_t RIS;
+	volatile uint32_t MIS;
+	volatile uint32_t ICR;
+	volatile uint32_t TAILR;
+	volatile uint32_t TAMATCHR;
+	volatile uint32_t TAV;
+} TIMER0_Type;
+
+typedef struct {
+	volatile uint32_t ENABLE;
+	volatile uint32_t INTEN;
+	volatile uint32_t _3_CTL;
+	volatile uint32_t _3_INTEN;
+	volatile uint32_t _3_RIS;
+	volatile uint32_t _3_ISC;
+	volatile uint32_t _3_LOAD;
+	volatile uint32_t _3_COUNT;
+	volatile uint32_t _3_CMPA;
+	volatile uint32_t _3_CMPB;
+	volatile uint32_t _3_GENA;
+} PWM0_Type;
+
+typedef struct {
+	volatile uint32_t CTL;
+	volatile uint32_t POS;
+	volatile uint32_t MAXPOS;
+	volatile uint32_t LOAD;
+	volatile uint32_t SPEED;
+} QEI0_Type;
+
+typedef struct {
+	volatile uint32_t ISER[8];  // write 1 to enable
+	volatile uint32_t ISPR[8];  // write 1 to pend
+	union {
+		volatile uint8_t IP[240];
+		volatile uint32_t IPR[60];
+	};
+} NVIC_Type;
+
+typedef struct {
+	volatile uint32_t CTRL;
+	volatile uint32_t CYCCNT;
+} DWT_Type;
+
+typedef struct {
+	volatile uint32_t DEMCR;
+} CoreDebug_Type;
+
+// SysTick and the system handler registers
+typedef struct {
+	volatile uint32_t ST_CTRL;
+	volatile uint32_t ST_RELOAD;
+	volatile uint32_t ST_CURRENT;
+	volatile uint32_t INT_CTRL;
+	volatile uint32_t SYS_PRI3;
+	volatile uint32_t CPAC;
+} Host_SCS_Type;
+
+extern GPIOA_Type host_gpio[6];      // ports A to F
+extern SYSCTL_Type host_sysctl;
+extern TIMER0_Type host_timer[2];
+extern PWM0_Type host_pwm1;
+extern QEI0_Type host_qei0;
+extern NVIC_Type host_nvic;
+extern DWT_Type host_dwt;
+extern CoreDebug_Type host_coredebug;
+extern Host_SCS_Type host_scs;
+
+#define GPIOA	HOST_BLOCK(GPIOA_Type, host_gpio[0])
+#define GPIOB	HOST_BLOCK(GPIOA_Type, host_gpio[1])
+#define GPIOC	HOST_BLOCK(GPIOA_Type, host_gpio[2])
+#define GPIOD	HOST_BLOCK(GPIOA_Type, host_gpio[3])
+#define GPIOE	HOST_BLOCK(GPIOA_Type, host_gpio[4])
+#define GPIOF	HOST_BLOCK(GPIOA_Type, host_gpio[5])
+#define SYSCTL	HOST_BLOCK(SYSCTL_Type, host_sysctl)
+#define TIMER0	HOST_BLOCK(TIMER0_Type, host_timer[0])
+#define TIMER1	HOST_BLOCK(TIMER0_Type, host_timer[1])
+#define PWM1	HOST_BLOCK(PWM0_Type, host_pwm1)
+#define QEI0	HOST_BLOCK(QEI0_Type, host_qei0)
+#define NVIC	HOST_BLOCK(NVIC_Type, host_nvic)
+#define DWT	HOST_BLOCK(DWT_Type, host_dwt)
+#define CoreDebug	HOST_BLOCK(CoreDebug_Type, host_coredebug)
+#define HOST_SCS	HOST_BLOCK(Host_SCS_Type, host_scs)
+
+#define CoreDebug_DEMCR_TRCENA_Msk	0x01000000
+#define DWT_CTRL_CYCCNTENA_Msk	0x00000001
+
+// the names of tm4c123gh6pm_def.h that the firmware uses
+#define SYSCTL_RCC_R	(SYSCTL->RCC)
+#define SYSCTL_RCGCGPIO_R	(SYSCTL->RCGCGPIO)
+#define SYSCTL_RCGCTIMER_R	(SYSCTL->RCGCTIMER)
+#define SYSCTL_RCGCQEI_R	(SYSCTL->RCGCQEI)
+#define SYSCTL_PRGPIO_R	(SYSCTL->PRGPIO)
+#define SYSCTL_PRTIMER_R	(SYSCTL->PRTIMER)
+#define SYSCTL_PRQEI_R	(SYSCTL->PRQEI)
+
+#define GPIO_PORTB_DATA_R	(GPIOB->DATA)
+#define GPIO_PORTB_DIR_R	(GPIOB->DIR)
+#define GPIO_PORTB_DEN_R	(GPIOB->DEN)
+#define GPIO_PORTC_DATA_BITS_R	((volatile uint32_t *)Host_Access((void *)host_gpio[2].DATA_BITS))
+#define GPIO_PORTC_DATA_R	(GPIOC->DATA)
+#define GPIO_PORTC_DIR_R	(GPIOC->DIR)
+#define GPIO_PORTC_IS_R	(GPIOC->IS)
+#define GPIO_PORTC_IBE_R	(GPIOC->IBE)
+#define GPIO_PORTC_IEV_R	(GPIOC->IEV)
+#define GPIO_PORTC_IM_R	(GPIOC->IM)
+#define GPIO_PORTC_ICR_R	(GPIOC->ICR)
+#define GPIO_PORTC_PUR_R	(GPIOC->PUR)
+#define GPIO_PORTC_DEN_R	(GPIOC->DEN)
+#define GPIO_PORTD_DATA_R	(GPIOD->DATA)
+#define GPIO_PORTD_DIR_R	(GPIOD->DIR)
+#define GPIO_PORTD_AFSEL_R	(GPIOD->AFSEL)
+#define GPIO_PORTD_DEN_R	(GPIOD->DEN)
+#define GPIO_PORTD_LOCK_R	(GPIOD->LOCK)
+#define GPIO_PORTD_CR_R	(GPIOD->CR)
+#define GPIO_PORTD_PCTL_R	(GPIOD->PCTL)
+#define GPIO_PORTE_DATA_R	(GPIOE->DATA)
+#define GPIO_PORTE_DIR_R	(GPIOE->DIR)
+#define GPIO_PORTE_DEN_R	(GPIOE->DEN)
+#define GPIO_LOCK_KEY	0x4C4F434B
+
+#define TIMER0_ICR_R	(TIMER0->ICR)
+#define TIMER1_CFG_R	(TIMER1->CFG)
+#define TIMER1_TAMR_R	(TIMER1->TAMR)
+#define TIMER1_CTL_R	(TIMER1->CTL)
+#define TIMER1_IMR_R	(TIMER1->IMR)
+#define TIMER1_MIS_R	(TIMER1->MIS)
+#define TIMER1_ICR_R	(TIMER1->ICR)
+#define TIMER1_TAILR_R	(TIMER1->TAILR)
+#define TIMER1_TAMATCHR_R	(TIMER1->TAMATCHR)
+#define TIMER1_TAV_R	(TIMER1->TAV)
+
+#define QEI0_CTL_R	(QEI0->CTL)
+#define QEI0_POS_R	(QEI0->POS)
+#define QEI0_MAXPOS_R	(QEI0->MAXPOS)
+#define QEI0_LOAD_R	(QEI0->LOAD)
+#define QEI0_SPEED_R	(QEI0->SPEED)
+#define QEI_CTL_FILTEN	0x00002000
+#define QEI_CTL_VELEN	0x00000020
+#define QEI_CTL_CAPMODE	0x00000008
+#define QEI_CTL_ENABLE	0x00000001
+
+#define NVIC_EN0_R	(NVIC->ISER[0])
+#define NVIC_PEND0_R	(NVIC->ISPR[0])
+#define NVIC_PRI5_R	(NVIC->IPR[5])
+#define NVIC_ST_CTRL_R	(HOST_SCS->ST_CTRL)
+#define NVIC_ST_RELOAD_R	(HOST_SCS->ST_RELOAD)
+#define NVIC_ST_CURRENT_R	(HOST_SCS->ST_CURRENT)
+#define NVIC_INT_CTRL_R	(HOST_SCS->INT_CTRL)
+#define NVIC_SYS_PRI3_R	(HOST_SCS->SYS_PRI3)
+#define NVIC_CPAC_R	(HOST_SCS->CPAC)
+
+#endif
@@ -0,0 +1,259 @@
+// board.c
+// Host tool, not part of the Keil project.
+// The board around the simulated TM4C123, see board.h.
+//
+// The motor is integrated in steps of at most MOTOR_STEP_CYCLES, with
+// the PWM output level held over each step; tm4c.c never lets time
+// cross a PWM edge unseen. The steps are not events of their own, as
+// the firmware only sees the motor at an event or a register access.
+// Time moves at least every MOTOR_IDLE_CYCLES, so a WFI with nothing
+// else to wait for still ends. The ADS7804 samples the motor terminal at the R/C
+// falling edge (PC4), holds BUSY (PC5) low for the conversion, and then
+// drives the byte that BYTE (PC7) selects onto DB7-DB4 (PE5-PE2) and
+// DB3-DB0 (PB5-PB2). BYTE is tied low when PC7 is not an output.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include "TM4C123GH6PM.h"
+#include "Encoder.h"
+#include "tm4c.h"
+#include "board.h"
+
+#define MOTOR_STEP_CYCLES	320      // 20 us, well below L/R
+#define MOTOR_IDLE_CYCLES	16000    // 1 ms
+#define KEY_QUEUE	64               // a power of two
+#define KEY_POLL_CYCLES	16000      // Scan_Keypad sees a key within 1 ms
+#define PI	3.14159265358979
+
+Motor_Model board_motor;
+uint64_t board_end = UINT64_MAX;
+void (*board_tick)(void);
+uint64_t board_tick_cycles;
+uint32_t board_conversion_count;
+char board_lcd[2][17];
+
+extern uint8_t Key_ASCII;          // in rtos_v2.c
+
+static uint64_t motor_time;        // the motor is integrated up to here
+static uint64_t next_tick;
+static Board_Conversion conversions[BOARD_CONVERSIONS];
+static int converting;
+static int32_t conversion_code;
+static uint32_t port_c;            // outputs of Port C last seen
+static double qei_edges;           // fraction of an edge not yet counted
+static uint64_t qei_window_end;
+static uint32_t qei_window_start;
+static int lcd_row, lcd_column;
+
+static struct {
+	uint64_t t;
+	char key;
+} keys[KEY_QUEUE];
+static uint32_t key_put, key_get;
+
+// ******** Board_Init ************
+// a motor at rest, BUSY high and no keys queued
+void Board_Init(void) {
+	int r, c;
+	Motor_Init(&board_motor);
+	motor_time = 0;
+	next_tick = board_tick_cycles;
+	converting = 0;
+	port_c = 0;
+	key_put = key_get = 0;
+	for (r = 0; r < 2; r++) {
+		for (c = 0; c < 16; c++) {
+			board_lcd[r][c] = ' ';
+		}
+		board_lcd[r][16] = 0;
+	}
+	TM4C_GPIO_Input(2, 0x20, 0x20);
+}
+
+// ******** Board_Key ************
+// queues a key press, in time order
+// input:  time of the press, bus cycles; the key's ASCII code
+void Board_Key(uint64_t t, char key) {
+	if (key_put - key_get == KEY_QUEUE) {
+		fprintf(stderr, "board: key queue full\n");
+		exit(1);
+	}
+	keys[key_put & (KEY_QUEUE - 1)].t = t;
+	keys[key_put & (KEY_QUEUE - 1)].key = key;
+	key_put++;
+}
+
+// ******** Board_Conversion_At ************
+// input:  time, bus cycles
+// output: the last conversion done at or before it, 0 if none is kept
+const Board_Conversion *Board_Conversion_At(uint64_t t) {
+	uint32_t n;
+	const Board_Conversion *c;
+	for (n = board_conversion_count; n > 0 && board_conversion_count - n < BOARD_CONVERSIONS; n--) {
+		c = &conversions[(n - 1) & (BOARD_CONVERSIONS - 1)];
+		if (c->done <= t) {
+			return c;
+		}
+	}
+	return 0;
+}
+
+// drives the byte the BYTE line selects onto the data pins
+static void Drive_Data(void) {
+	uint32_t byte;
+	if (port_c & 0x80) {
+		byte = (conversion_code & 0xF) << 4;  // D3-D0
+	} else {
+		byte = (conversion_code >> 4) & 0xFF; // D11-D4
+	}
+	TM4C_GPIO_Input(4, 0x3C, ((byte >> 4) & 0xF) << 2);
+	TM4C_GPIO_Input(1, 0x3C, (byte & 0xF) << 2);
+}
+
+void Board_GPIO_Output(uint32_t port, uint32_t level) {
+	Board_Conversion *c;
+	if (port != 2) {
+		return;
+	}
+	if ((port_c & 0x10) && !(level & 0x10) && !converting) {
+		// R/C falling edge, the ADS7804 ignores it while converting
+		converting = 1;
+		c = &conversions[board_conversion_count & (BOARD_CONVERSIONS - 1)];
+		c->start = tm4c_cycles;
+		c->done = tm4c_cycles + BOARD_CONVERSION_CYCLES;
+		conversion_code = Motor_ADC_Sample(&board_motor, TM4C_PWM_Level(tm4c_cycles), 12);
+		TM4C_GPIO_Input(2, 0x20, 0);
+	}
+	port_c = level;
+	if (!converting) {
+		Drive_Data();
+	}
+}
+
+static void Motor_Advance(uint64_t now) {
+	uint64_t step;
+	double edges;
+	uint32_t n;
+	while (motor_time < now) {
+		step = now - motor_time;
+		if (step > MOTOR_STEP_CYCLES) {
+			step = MOTOR_STEP_CYCLES;
+		}
+		Motor_Step(&board_motor, TM4C_PWM_Level(motor_time), (double)step / SystemCoreClock);
+		motor_time += step;
+		if (host_qei0.CTL & QEI_CTL_ENABLE) {
+			edges = qei_edges + board_motor.w / (2 * PI) * ENCODER_CPR * step / SystemCoreClock;
+			n = (uint32_t)floor(edges);
+			qei_edges = edges - n;
+			host_qei0.POS += n;
+		}
+	}
+}
+
+uint64_t Board_Next(void) {
+	uint64_t next = motor_time + MOTOR_IDLE_CYCLES;
+	if (converting && conversions[board_conversion_count & (BOARD_CONVERSIONS - 1)].done < next) {
+		next = conversions[board_conversion_count & (BOARD_CONVERSIONS - 1)].done;
+	}
+	if ((host_qei0.CTL & QEI_CTL_VELEN) && qei_window_end && qei_window_end < next) {
+		next = qei_window_end;
+	}
+	if (board_tick && next_tick < next) {
+		next = next_tick;
+	}
+	if (board_end < next) {
+		next = board_end;
+	}
+	return next;
+}
+
+void Board_Advance(uint64_t now) {
+	Motor_Advance(now);
+	if (converting && conversions[board_conversion_count & (BOARD_CONVERSIONS - 1)].done == now) {
+		converting = 0;
+		board_conversion_count++;
+		Drive_Data();
+		TM4C_GPIO_Input(2, 0x20, 0x20);
+	}
+	if (host_qei0.CTL & QEI_CTL_VELEN) {
+		if (qei_window_end == 0) {
+			qei_window_end = now + host_qei0.LOAD + 1;
+			qei_window_start = host_qei0.POS;
+		} else if (qei_window_end == now) {
+			host_qei0.SPEED = host_qei0.POS - qei_window_start;
+			qei_window_start = host_qei0.POS;
+			qei_window_end = now + host_qei0.LOAD + 1;
+		}
+	}
+	if (board_tick && next_tick == now) {
+		board_tick();
+		next_tick += board_tick_cycles;
+	}
+	if (now >= board_end) {
+		TM4C_Stop();
+	}
+}
+
+// ******** LCD.s ************
+// The LCD waits are Delay1ms busy loops, run with interrupts enabled.
+
+#define MS	16000                    // bus cycles
+
+static void LCD_Put(char c) {
+	if (lcd_column < 16) {
+		board_lcd[lcd_row][lcd_column++] = c;
+	}
+}
+
+void Init_LCD_Ports(void) {
+}
+
+void Init_LCD(void) {
+	TM4C_Run(46 * MS);
+	lcd_row = lcd_column = 0;
+}
+
+void Clear_LCD(void) {
+	int r, c;
+	for (r = 0; r < 2; r++) {
+		for (c = 0; c < 16; c++) {
+			board_lcd[r][c] = ' ';
+		}
+	}
+	lcd_row = lcd_column = 0;
+	TM4C_Run(3 * MS);
+}
+
+void Set_Position(int32_t pos) {
+	lcd_row = (pos & 0x40) != 0;
+	lcd_column = pos & 0x0F;
+	TM4C_Run(MS);
+}
+
+void Display_Char(char c) {
+	LCD_Put(c);
+	TM4C_Run(MS);
+}
+
+void Display_Msg(char *msg) {
+	while (*msg) {
+		Display_Char(*msg++);
+	}
+}
+
+// ******** Keypad.s ************
+
+void Init_Keypad(void) {
+}
+
+// Scan_Keypad spins until a key is down, then Read_Key waits 25 ms to
+// debounce it. Each queued press is read once.
+void Read_Key(void) {
+	while (key_get == key_put || keys[key_get & (KEY_QUEUE - 1)].t > tm4c_cycles) {
+		TM4C_Run(KEY_POLL_CYCLES);
+	}
+	TM4C_Run(25 * MS);
+	Key_ASCII = (uint8_t)keys[key_get & (KEY_QUEUE - 1)].key;
+	key_get++;
+}
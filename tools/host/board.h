@@ -0,0 +1,45 @@
+// board.h
+// Host tool, not part of the Keil project.
+// What is wired to the simulated TM4C123 of tools/host/tm4c.h: the
+// motor through the PWM1 generator 3 output, the ADS7804 on Ports B, C
+// and E, the encoder on QEI0, the LCD and the keypad. LCD.s and
+// Keypad.s are replaced by C stand-ins that take the time of the
+// assembly routines.
+
+#ifndef BOARD_H
+#define BOARD_H
+
+#include <stdint.h>
+#include "motor_model.h"
+
+// ADS7804 conversion time, bus cycles (8 us)
+#define BOARD_CONVERSION_CYCLES	128
+
+// conversions kept for Board_Conversion_At, a power of two
+#define BOARD_CONVERSIONS	256
+
+typedef struct {
+	uint64_t start;   // R/C falling edge, the motor voltage is sampled here
+	uint64_t done;    // BUSY rising edge
+} Board_Conversion;
+
+extern Motor_Model board_motor;
+
+// the run ends at this time, in bus cycles
+extern uint64_t board_end;
+
+// called every board_tick_cycles, in zero time, e.g. to change the
+// load or write a trace. It must not call TM4C_Run.
+extern void (*board_tick)(void);
+extern uint64_t board_tick_cycles;
+
+extern uint32_t board_conversion_count;
+
+// the two lines of the LCD
+extern char board_lcd[2][17];
+
+void Board_Init(void);
+void Board_Key(uint64_t t, char key);
+const Board_Conversion *Board_Conversion_At(uint64_t t);
+
+#endif
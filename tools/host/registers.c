@@ -0,0 +1,25 @@
+// registers.c
+// Host tool, not part of the Keil project.
+// The registers declared in tools/host/TM4C123GH6PM.h. Link it into a
+// host build of a module that touches them.
+
+#include <stdint.h>
+#include "TM4C123GH6PM.h"
+
+uint32_t SystemCoreClock = 16000000;
+
+// the clock is fixed at 16 MHz
+void SystemCoreClockUpdate(void) {
+}
+
+void (*host_access)(void *block);
+
+GPIOA_Type host_gpio[6];
+SYSCTL_Type host_sysctl = {.PRGPIO = 0xFFFFFFFF, .PRTIMER = 0xFFFFFFFF, .PRQEI = 0xFFFFFFFF};
+TIMER0_Type host_timer[2];
+PWM0_Type host_pwm1;
+QEI0_Type host_qei0;
+NVIC_Type host_nvic;
+DWT_Type host_dwt;
+CoreDebug_Type host_coredebug;
+Host_SCS_Type host_scs;
@@ -0,0 +1,752 @@
+// tm4c.c
+// Host tool, not part of the Keil project.
+// Simulated TM4C123 for the firmware simulation, see tm4c.h. Also the
+// stand-ins for the routines of startup_TM4C123.s and osasm_V2.s.
+//
+// Devices are brought up to an event time in time order, the board
+// first, so it integrates up to a PWM edge before the edge is applied.
+// Pending exceptions are taken wherever the real core could take them
+// between zero-time stretches of code: when PRIMASK or BASEPRI drops,
+// when a handler returns, and while time passes in TM4C_Run.
+//
+// Only the register behavior the firmware relies on is modeled:
+//   SysTick   core clock; COUNTFLAG clears when SysTick_Handler returns
+//   Timer0A   32-bit periodic count-down, TAILR reloaded at timeouts
+//   Timer1A   32-bit count-up with match interrupt
+//   PWM1 gen3 count-down, GENA low at LOAD and high at CMPA down,
+//             LOAD/CMPA/CMPB latched at the start of each period,
+//             comparator B down interrupt
+//   GPIO      edge interrupts, DATA_BITS writes
+//   NVIC      enables and pends are write 1 to set, no clearing
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <ucontext.h>
+#include "TM4C123GH6PM.h"
+#include "os.h"
+#include "tm4c.h"
+
+#define ENTRY_CYCLES	12         // exception entry, stacking the frame
+#define EXC_PENDSV	14
+#define EXC_SYSTICK	15
+#define EXC_IRQ(n)	(16 + (n))
+#define NUM_EXCEPTIONS	(16 + 240)
+#define NO_PRIORITY	0x100      // below every exception priority
+#define KERNEL_BASEPRI	(OS_KERNEL_PRIORITY << 5)
+#define DATA_BITS_IDLE	0xFFFFFFFF // DATA_BITS entry not written since the last access
+#define HOST_STACK_BYTES	(256 * 1024)
+#define MAX_CONTEXTS	8          // NUMTHREADS in os_v2.c
+
+// handlers of the firmware
+void SysTick_Handler(void);
+void GPIOC_Handler(void);
+void TIMER0A_Handler(void);
+void TIMER1A_Handler(void);
+void PWM1_3_Handler(void) __attribute__((weak)); // only with ADC_PWM_SYNC
+
+// called by PendSV_Handler in osasm_V2.s
+void OS_RunDeferred(void);
+void OS_SwitchDone(uint32_t start, uint32_t old_return, uint32_t new_return);
+
+// the TCB is private to os_v2.c, its first word is the saved stack pointer
+struct tcb;
+extern struct tcb *RunPt;
+extern struct tcb *NextPt;
+
+uint64_t tm4c_cycles;
+void (*tm4c_pwm_access)(void);
+
+// core
+static uint32_t primask;
+static uint32_t basepri;
+static uint32_t active[16];        // exceptions being handled, innermost last
+static uint32_t active_priority[16];
+static uint32_t depth;
+static uint32_t enabled[8];        // NVIC enables, kept as ISER is write 1 to set
+static uint32_t pending[8];
+static int pendsv_pending;
+static int systick_pending;
+static int stopped;
+
+// cycle counter, DWT->CYCCNT = tm4c_cycles - cycle_offset
+static uint64_t cycle_offset;
+static uint32_t cycles_shown;
+
+// SysTick
+static int systick_on;
+static uint64_t systick_next;      // next time it reaches zero
+static uint32_t current_shown;     // a write of NVIC_ST_CURRENT_R changes it
+
+// Timer0A and Timer1A
+typedef struct {
+	int on;
+	uint64_t start;                  // time it was enabled or last timed out
+	uint64_t period;                 // TAILR + 1 latched at start
+	uint64_t match_from;             // earliest time left for a match
+	uint32_t match;
+} Timer_State;
+static Timer_State timers[2];
+static uint32_t timer_touched = 0x3; // accessed or timed out since synced
+
+// PWM1 generator 3
+static struct {
+	int on;
+	uint64_t start;                  // start of the current period
+	uint64_t done;                   // time events are applied up to
+	uint32_t div;                    // bus cycles per PWM count
+	uint32_t load, cmpa, cmpb;       // latched at start
+} pwm;
+
+// GPIO
+static uint32_t pins[6];           // levels driven by the board
+static uint32_t outputs[6];        // output levels the board last saw
+static uint32_t gpio_touched = 0x3F; // ports accessed since they were last synced
+static uint32_t bits_written;      // ports whose DATA_BITS were accessed
+static const uint32_t gpio_irq[6] = {0, 1, 2, 3, 4, 30};
+
+// host contexts: the caller of TM4C_Reset, the firmware before
+// OS_Launch, and one for each thread
+static ucontext_t caller_context;
+static ucontext_t reset_context;
+static int (*reset_entry)(void);
+static struct {
+	struct tcb *tcb;
+	ucontext_t context;
+} contexts[MAX_CONTEXTS];
+static int num_contexts;
+static int switch_by_pendsv;       // 0 for the first thread, started by StartOS
+static uint32_t switch_start;
+
+static void Check_Interrupts(void);
+
+static void *Host_Stack(void) {
+	void *stack = malloc(HOST_STACK_BYTES);
+	if (stack == NULL) {
+		fprintf(stderr, "tm4c: out of memory for a thread stack\n");
+		exit(1);
+	}
+	return stack;
+}
+
+// ******** TM4C_Cycle_Count ************
+// output: what DWT->CYCCNT reads now
+uint32_t TM4C_Cycle_Count(void) {
+	return (uint32_t)(tm4c_cycles - cycle_offset);
+}
+
+static void Cycle_Count_Sync(void) {
+	if (host_dwt.CYCCNT != cycles_shown) {
+		cycle_offset = tm4c_cycles - host_dwt.CYCCNT; // written by the firmware
+	}
+	cycles_shown = TM4C_Cycle_Count();
+	host_dwt.CYCCNT = cycles_shown;
+}
+
+// ******** Exceptions ************
+
+static uint32_t Priority(uint32_t e) {
+	if (e == EXC_PENDSV) return (host_scs.SYS_PRI3 >> 16) & 0xE0;
+	if (e == EXC_SYSTICK) return (host_scs.SYS_PRI3 >> 24) & 0xE0;
+	return host_nvic.IP[e - 16] & 0xE0;
+}
+
+static int Active(uint32_t e) {
+	uint32_t i;
+	for (i = 0; i < depth; i++) {
+		if (active[i] == e) {
+			return 1;
+		}
+	}
+	return 0;
+}
+
+// pends an interrupt whose request line is asserted. One being handled
+// is pended again only if the line is still asserted when it returns.
+static void Raise(uint32_t e) {
+	if (!Active(e)) {
+		pending[(e - 16) / 32] |= 1u << ((e - 16) % 32);
+	}
+}
+
+static void Clear_Pending(uint32_t e) {
+	if (e == EXC_PENDSV) {
+		pendsv_pending = 0;
+	} else if (e == EXC_SYSTICK) {
+		systick_pending = 0;
+	} else {
+		pending[(e - 16) / 32] &= ~(1u << ((e - 16) % 32));
+		host_nvic.ISPR[(e - 16) / 32] = pending[(e - 16) / 32];
+	}
+}
+
+// the pending enabled exception to take next, lowest priority value
+// first and then lowest number. Returns 0 if there is none.
+static int Highest_Pending(uint32_t *exception, uint32_t *priority) {
+	uint32_t best = 0, best_priority = NO_PRIORITY, k, bits, e, p;
+	if (systick_pending && Priority(EXC_SYSTICK) < best_priority) {
+		best = EXC_SYSTICK;
+		best_priority = Priority(EXC_SYSTICK);
+	}
+	if (pendsv_pending && Priority(EXC_PENDSV) < best_priority) {
+		best = EXC_PENDSV;
+		best_priority = Priority(EXC_PENDSV);
+	}
+	for (k = 0; k < 8; k++) {
+		bits = pending[k] & enabled[k];
+		while (bits) {
+			e = EXC_IRQ(32 * k + __builtin_ctz(bits));
+			bits &= bits - 1;
+			p = Priority(e);
+			if (p < best_priority) {
+				best = e;
+				best_priority = p;
+			}
+		}
+	}
+	*exception = best;
+	*priority = best_priority;
+	return best != 0;
+}
+
+// the priority an exception must beat to be taken, PRIMASK aside
+static uint32_t Execution_Priority(void) {
+	uint32_t p = depth ? active_priority[depth - 1] : NO_PRIORITY;
+	if (basepri != 0 && basepri < p) {
+		p = basepri;
+	}
+	return p;
+}
+
+static void (*Vector(uint32_t e))(void) {
+	switch (e) {
+	case EXC_SYSTICK:	return SysTick_Handler;
+	case EXC_IRQ(2):	return GPIOC_Handler;
+	case EXC_IRQ(19):	return TIMER0A_Handler;
+	case EXC_IRQ(21):	return TIMER1A_Handler;
+	case EXC_IRQ(137):	return PWM1_3_Handler;
+	}
+	return 0;
+}
+
+// ******** Thread contexts ************
+
+static ucontext_t *Context_Of(struct tcb *t) {
+	int i;
+	for (i = 0; i < num_contexts; i++) {
+		if (contexts[i].tcb == t) {
+			return &contexts[i].context;
+		}
+	}
+	return 0;
+}
+
+// the task os_v2.c put in the PC slot of the thread's initial frame
+static void (*Task_Of(struct tcb *t))(void) {
+	int32_t *sp = *(int32_t **)t;
+	return (void (*)(void))(uintptr_t)(uint32_t)sp[15];
+}
+
+// completes the switch into the thread that now runs, as the end of
+// PendSV_Handler or of StartOS would
+static void Switch_Done(void) {
+	if (switch_by_pendsv) {
+		OS_SwitchDone(switch_start, 0xFFFFFFF9, 0xFFFFFFF9);
+		basepri = 0;
+	} else {
+		primask = 0;
+	}
+}
+
+// first code run on a thread's context
+static void Thread_Start(void) {
+	void (*task)(void) = Task_Of(RunPt);
+	Switch_Done();
+	Check_Interrupts();
+	task();
+	fprintf(stderr, "tm4c: a thread returned from its task\n");
+	exit(1);
+}
+
+static ucontext_t *New_Context(struct tcb *t) {
+	ucontext_t *c;
+	if (num_contexts == MAX_CONTEXTS) {
+		fprintf(stderr, "tm4c: more threads than NUMTHREADS\n");
+		exit(1);
+	}
+	contexts[num_contexts].tcb = t;
+	c = &contexts[num_contexts++].context;
+	getcontext(c);
+	c->uc_stack.ss_sp = Host_Stack();
+	c->uc_stack.ss_size = HOST_STACK_BYTES;
+	c->uc_link = 0;
+	makecontext(c, Thread_Start, 0);
+	return c;
+}
+
+// PendSV_Handler of osasm_V2.s. It ends the exception before the swap,
+// as the switch returns from it on the new thread.
+static void PendSV(void) {
+	struct tcb *old;
+	ucontext_t *from, *to;
+	OS_RunDeferred();
+	basepri = KERNEL_BASEPRI;
+	if (RunPt == NextPt) {
+		basepri = 0;
+		depth--;
+		return;
+	}
+	old = RunPt;
+	switch_start = TM4C_Cycle_Count();
+	switch_by_pendsv = 1;
+	RunPt = NextPt;
+	depth--;
+	from = Context_Of(old);
+	to = Context_Of(RunPt);
+	if (to == 0) {
+		to = New_Context(RunPt);
+	}
+	swapcontext(from, to);
+	Switch_Done();                // switched back to by another PendSV
+}
+
+// ******** Peripherals ************
+
+static void SysTick_Sync(void) {
+	if (host_scs.INT_CTRL & 0x10000000) {
+		pendsv_pending = 1;
+	}
+	if (host_scs.INT_CTRL & 0x08000000) {
+		pendsv_pending = 0;
+	}
+	host_scs.INT_CTRL = 0;
+	if (host_scs.ST_CTRL & 0x01) {
+		if (!systick_on || host_scs.ST_CURRENT != current_shown) {
+			systick_on = 1;         // enabled, or CURRENT cleared
+			systick_next = tm4c_cycles + (host_scs.ST_RELOAD & 0xFFFFFF) + 1;
+		}
+		current_shown = (uint32_t)(systick_next - tm4c_cycles);
+	} else {
+		systick_on = 0;
+		current_shown = 1;
+	}
+	host_scs.ST_CURRENT = current_shown;
+}
+
+static void Timer_Sync(uint32_t n) {
+	TIMER0_Type *t = &host_timer[n];
+	Timer_State *s = &timers[n];
+	uint64_t count;
+	if (t->ICR) {
+		t->RIS &= ~t->ICR;
+		t->ICR = 0;
+	}
+	if ((t->CTL & 0x01) && !s->on) {
+		s->on = 1;
+		s->start = tm4c_cycles;
+		s->period = (uint64_t)t->TAILR + 1;
+	} else if ((t->CTL & 0x01) == 0) {
+		s->on = 0;
+	}
+	if (!(t->IMR & 0x10) || (t->TAMATCHR != s->match)) {
+		s->match_from = tm4c_cycles + 1; // only armed matches from now on count
+		s->match = t->TAMATCHR;
+	}
+	if (s->on) {
+		count = (tm4c_cycles - s->start) % s->period;
+		t->TAV = (t->TAMR & 0x10) ? (uint32_t)count : (uint32_t)(s->period - 1 - count);
+	}
+	t->MIS = t->RIS & t->IMR;
+}
+
+static void PWM_Latch(void) {
+	pwm.load = host_pwm1._3_LOAD & 0xFFFF;
+	pwm.cmpa = host_pwm1._3_CMPA & 0xFFFF;
+	pwm.cmpb = host_pwm1._3_CMPB & 0xFFFF;
+	if (host_sysctl.RCC & 0x00100000) {  // USEPWMDIV
+		uint32_t shift = (host_sysctl.RCC >> 17) & 0x7;
+		pwm.div = 2u << (shift < 5 ? shift : 5);
+	} else {
+		pwm.div = 1;
+	}
+}
+
+static void PWM_Sync(void) {
+	if (host_pwm1._3_ISC) {
+		host_pwm1._3_RIS &= ~host_pwm1._3_ISC;
+		host_pwm1._3_ISC = 0;
+	}
+	if ((host_pwm1._3_CTL & 0x01) && !pwm.on) {
+		pwm.on = 1;
+		pwm.start = tm4c_cycles;
+		pwm.done = tm4c_cycles;
+		PWM_Latch();
+	} else if ((host_pwm1._3_CTL & 0x01) == 0) {
+		pwm.on = 0;
+	}
+	if (pwm.on) {
+		host_pwm1._3_COUNT = pwm.load - (uint32_t)((tm4c_cycles - pwm.start) / pwm.div);
+	}
+}
+
+// time the counter reaches a compare value in the current period
+static uint64_t PWM_Compare_Time(uint32_t cmp) {
+	return pwm.start + (uint64_t)(pwm.load - cmp) * pwm.div;
+}
+
+// ******** TM4C_PWM_Level ************
+// level of the PWM1 generator 3 output (PF2)
+// input:  time, within the current PWM period
+// output: 1 if the motor is driven
+int TM4C_PWM_Level(uint64_t t) {
+	if (!pwm.on || !(host_pwm1.ENABLE & 0x40) || pwm.cmpa > pwm.load) {
+		return 0;
+	}
+	return (t - pwm.start) / pwm.div >= pwm.load - pwm.cmpa;
+}
+
+static void GPIO_Sync(void) {
+	uint32_t p, m, out;
+	GPIOA_Type *g;
+	for (p = 0; p < 6; p++) {
+		if (!(gpio_touched & (1u << p))) {
+			continue;                 // TM4C_GPIO_Input keeps DATA and MIS up to date
+		}
+		g = &host_gpio[p];
+		if (bits_written & (1u << p)) {
+			for (m = 1; m < 256; m++) {
+				if (g->DATA_BITS[m] != DATA_BITS_IDLE) {
+					g->DATA = (g->DATA & ~m) | (g->DATA_BITS[m] & m);
+					g->DATA_BITS[m] = DATA_BITS_IDLE;
+				}
+			}
+		}
+		if (g->ICR) {
+			g->RIS &= ~g->ICR;
+			g->ICR = 0;
+		}
+		out = g->DATA & g->DIR;
+		if (out != outputs[p]) {
+			outputs[p] = out;
+			Board_GPIO_Output(p, out);  // may drive other pins at once
+		}
+		g->DATA = (g->DATA & g->DIR) | (pins[p] & ~g->DIR);
+		g->MIS = g->RIS & g->IM;
+	}
+	gpio_touched = 0;
+	bits_written = 0;
+}
+
+// ******** TM4C_GPIO_Input ************
+// drives input pins of a port, with the edge interrupts they cause
+// input:  port (0 for A to 5 for F), pins to drive, their levels
+// output: none
+void TM4C_GPIO_Input(uint32_t port, uint32_t mask, uint32_t level) {
+	GPIOA_Type *g = &host_gpio[port];
+	uint32_t old = pins[port], changed, edges;
+	pins[port] = (old & ~mask) | (level & mask);
+	changed = (old ^ pins[port]) & ~g->IS;
+	edges = (changed & g->IBE) | (changed & ~g->IBE & ~(pins[port] ^ g->IEV));
+	g->RIS |= edges;
+	g->DATA = (g->DATA & g->DIR) | (pins[port] & ~g->DIR);
+	g->MIS = g->RIS & g->IM;
+	if (g->MIS) {
+		Raise(EXC_IRQ(gpio_irq[port]));
+	}
+}
+
+static void NVIC_Sync(void) {
+	uint32_t k;
+	for (k = 0; k < 8; k++) {
+		enabled[k] |= host_nvic.ISER[k];
+		host_nvic.ISER[k] = enabled[k];
+		pending[k] |= host_nvic.ISPR[k];
+		host_nvic.ISPR[k] = pending[k];
+	}
+}
+
+// applies the register writes made since the last sync and pends the
+// interrupts whose request lines are asserted
+static void Sync(void) {
+	uint32_t p;
+	NVIC_Sync();
+	SysTick_Sync();
+	if (timer_touched & 1) Timer_Sync(0);
+	if (timer_touched & 2) Timer_Sync(1);
+	timer_touched = 0;
+	PWM_Sync();
+	GPIO_Sync();
+	Cycle_Count_Sync();
+	if (host_timer[0].MIS) Raise(EXC_IRQ(19));
+	if (host_timer[1].MIS) Raise(EXC_IRQ(21));
+	if ((host_pwm1._3_RIS & host_pwm1._3_INTEN) && (host_pwm1.INTEN & 0x08)) Raise(EXC_IRQ(137));
+	for (p = 0; p < 6; p++) {
+		if (host_gpio[p].MIS) Raise(EXC_IRQ(gpio_irq[p]));
+	}
+}
+
+// called before every register access through TM4C123GH6PM.h
+static void Access(void *block) {
+	char *b = block;
+	if (block == &host_dwt) {
+		Cycle_Count_Sync();
+	} else if (b >= (char *)host_gpio && b < (char *)(host_gpio + 6)) {
+		uint32_t port = (uint32_t)((b - (char *)host_gpio) / sizeof(GPIOA_Type));
+		GPIO_Sync();
+		gpio_touched |= 1u << port;   // the access may be a write, applied at the next sync
+		if (block != &host_gpio[port]) {
+			bits_written |= 1u << port;
+		}
+	} else if (block == &host_timer[0] || block == &host_timer[1]) {
+		Timer_Sync(block == &host_timer[1]);
+		timer_touched |= (block == &host_timer[1]) ? 2 : 1;
+	} else if (block == &host_pwm1) {
+		if (tm4c_pwm_access) {
+			tm4c_pwm_access();
+		}
+		PWM_Sync();
+	}
+}
+
+// ******** Time ************
+
+static uint64_t Next_Event(void) {
+	uint64_t next = Board_Next(), t;
+	uint32_t n;
+	if (systick_on && systick_next < next) next = systick_next;
+	for (n = 0; n < 2; n++) {
+		Timer_State *s = &timers[n];
+		if (!s->on) continue;
+		if (s->start + s->period < next) next = s->start + s->period;
+		if ((host_timer[n].TAMR & 0x10) && (host_timer[n].IMR & 0x10)) {
+			uint64_t from = (s->match_from > s->start) ? s->match_from : s->start;
+			t = s->start + (from - s->start) / s->period * s->period + s->match;
+			if (t < from) t += s->period;
+			if (t < next) next = t;
+		}
+	}
+	if (pwm.on) {
+		t = pwm.start + (uint64_t)(pwm.load + 1) * pwm.div;
+		if (t < next) next = t;
+		if (pwm.cmpa <= pwm.load && (t = PWM_Compare_Time(pwm.cmpa)) > pwm.done && t < next) next = t;
+		if (pwm.cmpb <= pwm.load && (t = PWM_Compare_Time(pwm.cmpb)) > pwm.done && t < next) next = t;
+	}
+	return next;
+}
+
+// moves time to t, no later than the next event, applying the events at t
+static void Step_To(uint64_t t) {
+	uint32_t n;
+	tm4c_cycles = t;
+	Board_Advance(t);
+	if (systick_on && systick_next == t) {
+		host_scs.ST_CTRL |= 0x10000;  // COUNTFLAG
+		if (host_scs.ST_CTRL & 0x02) {
+			systick_pending = 1;
+		}
+		systick_next += (host_scs.ST_RELOAD & 0xFFFFFF) + 1;
+	}
+	for (n = 0; n < 2; n++) {
+		Timer_State *s = &timers[n];
+		if (!s->on) continue;
+		if (s->start + s->period == t) {
+			host_timer[n].RIS |= 0x01;  // timeout
+			timer_touched |= 1u << n;
+			s->start = t;
+			s->period = (uint64_t)host_timer[n].TAILR + 1;
+		}
+		if ((host_timer[n].TAMR & 0x10) && (host_timer[n].IMR & 0x10) &&
+		    t >= s->match_from && (uint32_t)((t - s->start) % s->period) == s->match) {
+			host_timer[n].RIS |= 0x10;  // match
+			timer_touched |= 1u << n;
+			s->match_from = t + 1;
+		}
+	}
+	if (pwm.on) {
+		if (pwm.start + (uint64_t)(pwm.load + 1) * pwm.div == t) {
+			pwm.start = t;
+			PWM_Latch();
+		}
+		if (pwm.cmpb <= pwm.load && PWM_Compare_Time(pwm.cmpb) == t) {
+			host_pwm1._3_RIS |= 0x20; // comparator B down
+		}
+		pwm.done = t;
+	}
+}
+
+// lets time pass without taking exceptions
+static void Advance(uint64_t cycles) {
+	uint64_t end = tm4c_cycles + cycles, next;
+	while (tm4c_cycles < end) {
+		Sync();
+		next = Next_Event();
+		Step_To(next < end ? next : end);
+	}
+}
+
+// takes an exception: the entry, the handler, the return
+static void Take(uint32_t e, uint32_t priority) {
+	void (*handler)(void);
+	Clear_Pending(e);
+	active[depth] = e;
+	active_priority[depth] = priority;
+	depth++;
+	Advance(ENTRY_CYCLES);
+	Check_Interrupts();          // arrived during the entry
+	if (e == EXC_PENDSV) {
+		PendSV();                  // returns the exception itself
+		return;
+	}
+	handler = Vector(e);
+	if (handler == 0) {
+		fprintf(stderr, "tm4c: no handler for exception %u\n", e);
+		exit(1);
+	}
+	handler();
+	depth--;
+	if (e == EXC_SYSTICK) {
+		host_scs.ST_CTRL &= ~0x10000;
+	}
+}
+
+// takes the pending exceptions the current priority and masks allow
+static void Check_Interrupts(void) {
+	uint32_t e, priority;
+	if (stopped) {
+		return;
+	}
+	Sync();
+	while (!primask && Highest_Pending(&e, &priority) && priority < Execution_Priority()) {
+		Take(e, priority);
+		Sync();
+	}
+}
+
+// ******** TM4C_Run ************
+// lets time pass on the running code, as a busy loop does. Exceptions
+// are taken as they arrive; the time spent in them and in other
+// threads does not count.
+// input:  bus cycles
+// output: none
+void TM4C_Run(uint64_t cycles) {
+	uint64_t next, step;
+	while (cycles) {
+		Sync();
+		next = Next_Event();
+		step = (next - tm4c_cycles < cycles) ? next - tm4c_cycles : cycles;
+		Step_To(tm4c_cycles + step);
+		cycles -= step;
+		Check_Interrupts();
+	}
+}
+
+// ******** TM4C_Init ************
+// registers at their reset values, except the PR registers, which
+// read as ready, and time 0
+void TM4C_Init(void) {
+	uint32_t p, m;
+	for (p = 0; p < 6; p++) {
+		for (m = 0; m < 256; m++) {
+			host_gpio[p].DATA_BITS[m] = DATA_BITS_IDLE;
+		}
+	}
+	host_access = Access;
+}
+
+static void Reset_Start(void) {
+	reset_entry();
+	TM4C_Stop();
+}
+
+// ******** TM4C_Reset ************
+// runs the firmware from its main, given as entry, until TM4C_Stop.
+// Build with -no-pie: os_v2.c keeps each thread's entry point in a
+// 32-bit stack word.
+// input:  the firmware's main
+// output: none
+void TM4C_Reset(int (*entry)(void)) {
+	if ((uintptr_t)(uint32_t)(uintptr_t)&Thread_Start != (uintptr_t)&Thread_Start) {
+		fprintf(stderr, "tm4c: code above 4 GB, link with -no-pie\n");
+		exit(1);
+	}
+	reset_entry = entry;
+	getcontext(&reset_context);
+	reset_context.uc_stack.ss_sp = Host_Stack();
+	reset_context.uc_stack.ss_size = HOST_STACK_BYTES;
+	reset_context.uc_link = 0;
+	makecontext(&reset_context, Reset_Start, 0);
+	swapcontext(&caller_context, &reset_context);
+}
+
+// ******** TM4C_Stop ************
+// ends the run, returning from TM4C_Reset. No exception is taken after.
+void TM4C_Stop(void) {
+	stopped = 1;
+	setcontext(&caller_context);
+}
+
+// ******** Core intrinsics ************
+
+void __WFI(void) {
+	uint32_t e, priority;
+	Sync();
+	while (!(Highest_Pending(&e, &priority) && priority < Execution_Priority())) {
+		Step_To(Next_Event());
+		Sync();
+	}
+}
+
+void __enable_irq(void) {
+	primask = 0;
+	Check_Interrupts();
+}
+
+void __set_BASEPRI(uint32_t value) {
+	basepri = value & 0xE0;
+	Check_Interrupts();
+}
+
+uint32_t __get_IPSR(void) {
+	return depth ? active[depth - 1] : 0;
+}
+
+// ******** startup_TM4C123.s ************
+
+void DisableInterrupts(void) {
+	primask = 1;
+}
+
+void EnableInterrupts(void) {
+	__enable_irq();
+}
+
+int32_t StartCritical(void) {
+	int32_t old = (int32_t)primask;
+	primask = 1;
+	return old;
+}
+
+void EndCritical(int32_t old) {
+	primask = (uint32_t)old;
+	Check_Interrupts();
+}
+
+void WaitForInterrupt(void) {
+	__WFI();
+}
+
+// ******** osasm_V2.s ************
+
+void OS_DisableInterrupts(void) {
+	primask = 1;
+}
+
+void OS_EnableInterrupts(void) {
+	__enable_irq();
+}
+
+// starts the thread at RunPt with interrupts enabled
+void StartOS(void) {
+	switch_by_pendsv = 0;
+	setcontext(New_Context(RunPt));
+}
@@ -0,0 +1,42 @@
+// tm4c.h
+// Host tool, not part of the Keil project.
+// Simulated TM4C123 that the firmware's own modules run on: the
+// Cortex-M4 exceptions (NVIC, PRIMASK, BASEPRI, SysTick, PendSV),
+// Timer0A, Timer1A, PWM1 generator 3 and the GPIO interrupts, behind
+// the registers of tools/host/TM4C123GH6PM.h. The threads of os_v2.c
+// run on host contexts, switched where PendSV_Handler would switch them.
+//
+// The firmware's C code takes no simulated time. Time passes only in
+// TM4C_Run, which stands in for the busy loops of the assembly routines,
+// in WFI, and in the 12 cycles of every exception entry. So the
+// latencies measured are those of the interrupt and thread structure
+// (conversion time, batching, priorities, busy waits), not of the code.
+//
+// What is wired to the pins is the board, which provides the Board_
+// functions below (tools/host/board.c).
+
+#ifndef TM4C_H
+#define TM4C_H
+
+#include <stdint.h>
+
+// bus cycles since reset, at 16 MHz
+extern uint64_t tm4c_cycles;
+
+// called before every access to PWM1, so a tool can see the duty writes
+extern void (*tm4c_pwm_access)(void);
+
+void TM4C_Init(void);
+void TM4C_Reset(int (*entry)(void));
+void TM4C_Stop(void);
+void TM4C_Run(uint64_t cycles);
+uint32_t TM4C_Cycle_Count(void);
+int TM4C_PWM_Level(uint64_t t);
+void TM4C_GPIO_Input(uint32_t port, uint32_t mask, uint32_t level);
+
+// supplied by the board
+uint64_t Board_Next(void);
+void Board_Advance(uint64_t now);
+void Board_GPIO_Output(uint32_t port, uint32_t level);
+
+#endif
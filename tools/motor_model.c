@@ -0,0 +1,104 @@
+// motor_model.c
+// Host tool, not part of the Keil project.
+// Plant model for simulating the speed controller.
+
+#include <math.h>
+#include "motor_model.h"
+
+#define PI	3.14159265358979
+
+// ******** Motor_Init ************
+// nominal parameters of a small 12 V brushed motor, at rest
+void Motor_Init(Motor_Model *m) {
+	m->R = 2.0;
+	m->L = 0.002;
+	m->Ke = 0.038;
+	m->Kt = 0.038;
+	m->J = 2e-5;
+	m->B = 2e-4;
+	m->v_supply = 12.0;
+	m->sense_gain = 0.8;
+	m->sense_noise = 0;
+	m->load = 0;
+	m->i = 0;
+	m->w = 0;
+	m->seed = 1;
+}
+
+// ******** Motor_PWM_Output ************
+// level of PWM1 generator 3 as set up in MOT12_Init: the counter runs
+// down from LOAD, the output is low from LOAD to CMPA and high below it
+// input:  PWM clock counts since the start of the period, duty, period
+// output: 1 if the motor is driven
+int Motor_PWM_Output(uint32_t count, uint32_t duty, uint32_t period) {
+	return count >= period - duty;
+}
+
+// ******** Motor_Step ************
+// advances the motor by dt seconds (explicit Euler, dt well below L/R).
+// While the bridge is off the current freewheels through the diodes
+// until it reaches zero.
+void Motor_Step(Motor_Model *m, int on, double dt) {
+	double v = on ? m->v_supply : 0;
+	double torque;
+
+	if (on || m->i > 0) {
+		m->i += dt * (v - m->R * m->i - m->Ke * m->w) / m->L;
+		if (!on && m->i < 0) {
+			m->i = 0; // diode stops conducting
+		}
+	}
+
+	torque = m->Kt * m->i - m->B * m->w - m->load;
+	m->w += dt * torque / m->J;
+	if (m->w < 0) {
+		m->w = 0; // the load cannot drive the motor backwards
+	}
+}
+
+// ******** Motor_Terminal ************
+// output: motor terminal voltage, the back-EMF when open circuit
+double Motor_Terminal(Motor_Model *m, int on) {
+	if (on) return m->v_supply;
+	if (m->i > 0) return 0;
+	return m->Ke * m->w;
+}
+
+// ******** Motor_RPM ************
+double Motor_RPM(Motor_Model *m) {
+	return m->w * 60 / (2 * PI);
+}
+
+// uniform in (0, 1)
+static double Motor_Uniform(Motor_Model *m) {
+	m->seed = m->seed * 1664525 + 1013904223;
+	return ((m->seed >> 8) + 0.5) / 16777216.0;
+}
+
+// ******** Motor_ADC_Sample ************
+// quantizes the sensed terminal voltage like the external ADC
+// (+-10 V, 205 codes per volt) and returns it in the format of
+// Retrieve_Sample_ADC: 12 LSBs, with the 4 LSBs zero in 8-bit mode.
+// Gaussian noise of sense_noise rms is added before quantizing, but not
+// below 0 V, where the terminal never goes: Sample_to_Millivolts, like
+// the code it replaced, does not read codes from 0x800 up as negative.
+int32_t Motor_ADC_Sample(Motor_Model *m, int on, int bits) {
+	double volts = Motor_Terminal(m, on) * m->sense_gain;
+	int32_t code;
+
+	if (m->sense_noise > 0) {
+		volts += m->sense_noise * sqrt(-2 * log(Motor_Uniform(m))) * cos(2 * PI * Motor_Uniform(m));
+		if (volts < 0) {
+			volts = 0;
+		}
+	}
+	code = (int32_t)floor(volts * 205 + 0.5);
+
+	if (code > 2047) code = 2047;
+	if (code < -2048) code = -2048;
+	code &= 0xFFF;
+	if (bits == 8) {
+		code &= 0xFF0;
+	}
+	return code;
+}
@@ -0,0 +1,38 @@
+// motor_model.h
+// Host tool, not part of the Keil project.
+// Plant model for simulating the speed controller: PWM1 generator 3
+// output, H-bridge, brushed DC motor (electrical and mechanical ODE) and
+// the external ADC's quantizer, with optional noise at its input.
+
+#ifndef MOTOR_MODEL_H
+#define MOTOR_MODEL_H
+
+#include <stdint.h>
+
+typedef struct {
+	// parameters
+	double R;           // armature resistance, ohm
+	double L;           // armature inductance, H
+	double Ke;          // back-EMF constant, V/(rad/s)
+	double Kt;          // torque constant, N*m/A
+	double J;           // rotor and load inertia, kg*m^2
+	double B;           // viscous friction, N*m/(rad/s)
+	double v_supply;    // H-bridge supply, V
+	double sense_gain;  // ADC input volts per motor terminal volt
+	double sense_noise; // rms noise at the ADC input, V
+	// inputs
+	double load;        // load torque, N*m
+	// state
+	double i;           // armature current, A
+	double w;           // speed, rad/s
+	uint32_t seed;      // noise generator
+} Motor_Model;
+
+void Motor_Init(Motor_Model *m);
+int Motor_PWM_Output(uint32_t count, uint32_t duty, uint32_t period);
+void Motor_Step(Motor_Model *m, int on, double dt);
+double Motor_Terminal(Motor_Model *m, int on);
+double Motor_RPM(Motor_Model *m);
+int32_t Motor_ADC_Sample(Motor_Model *m, int on, int bits);
+
+#endif
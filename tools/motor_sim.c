@@ -0,0 +1,167 @@
+// motor_sim.c
+// Host tool, not part of the Keil project.
+// Runs the firmware against the motor model through a load profile,
+// faster than real time, and writes a trace for regression. main() of
+// rtos_v2.c runs on the simulated TM4C123 of tools/host/tm4c.c with the
+// board of tools/host/board.c: the threads of os_v2.c, the ADC
+// interrupts and ADC_Process of ADC.c, the PWM of PWM.c and the
+// controller are the firmware's own code. Setpoints are typed on the
+// keypad, so Keypad() takes them as it would from a user.
+//
+// Build:  cmake -S . -B build && cmake --build build --target motor_sim
+//         Set the same ADC_12BIT, ADC_PWM_SYNC, SPEED_OBSERVER and
+//         SPEED_ENCODER options as the firmware being simulated, e.g.
+//         cmake -S . -B build -DADC_PWM_SYNC=ON. It must be linked with
+//         -no-pie, see CMakeLists.txt.
+// Usage:  motor_sim [-d decimation] profile.csv > trace.csv
+//
+// Each profile line is "seconds,setpoint_rpm,load_torque_Nm"; a line
+// holds until the time of the next one and the last line ends the run.
+// A new setpoint is typed as four digits and '#', KEY_GAP_MS apart.
+// The trace has one line every decimation milliseconds (default 10):
+// time, setpoint (des_rpm), true RPM, measured RPM (cur_rpm), duty (N)
+// and latency_us, the longest time in the interval from the sampling
+// instant of a conversion until the controller that used it wrote the
+// duty, or -1 if the controller did not run.
+//
+// The exit status is 1 if a conversion was missed or dropped, the
+// control loop missed a deadline or a deferred signal was lost.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "ADC.h"
+#include "tm4c.h"
+#include "board.h"
+
+#define MAX_PROFILE	4096
+#define KEY_GAP_MS	50
+#define TICK_HZ	1000
+
+typedef struct {
+	double t;
+	int32_t rpm;
+	double load;
+} Profile_Point;
+
+extern int32_t des_rpm;            // in rtos_v2.c
+extern int32_t cur_rpm;
+extern uint32_t N;
+extern CycleStats ControlLatency;
+extern uint32_t DeferredLost;      // in os_v2.c
+int Firmware_Main(void);           // main of rtos_v2.c, renamed by the build
+
+static Profile_Point profile[MAX_PROFILE];
+static int points, point = -1;
+static long decimation = 10, ticks;
+static int64_t latency = -1;       // most cycles in this trace interval
+static int64_t max_latency = -1;
+static uint32_t latency_count;     // ControlLatency.count last seen
+
+// called before each PWM1 access. Once per controller iteration, when
+// it sets the duty, finds the conversion of the last sample ADC_Process
+// took from adc_ring.
+static void PWM_Access(void) {
+	uint32_t captured;
+	uint64_t t;
+	const Board_Conversion *c;
+	if (ControlLatency.count == latency_count) {
+		return;
+	}
+	latency_count = ControlLatency.count;
+	captured = adc_ring.buf[(adc_ring.get - 1) & (SAMPLE_RING_SIZE - 1)].time;
+	t = tm4c_cycles - (uint32_t)(TM4C_Cycle_Count() - captured);
+	c = Board_Conversion_At(t);
+	if (c && (int64_t)(tm4c_cycles - c->start) > latency) {
+		latency = tm4c_cycles - c->start;
+	}
+}
+
+static void Type_Setpoint(int32_t rpm) {
+	char keys[8];
+	uint64_t ms = SystemCoreClock / 1000;
+	int k;
+	snprintf(keys, sizeof(keys), "%04d#", (int)rpm);
+	for (k = 0; keys[k]; k++) {
+		Board_Key(tm4c_cycles + k * KEY_GAP_MS * ms, keys[k]);
+	}
+}
+
+static void Tick(void) {
+	double t = (double)tm4c_cycles / SystemCoreClock;
+	while (point + 1 < points && t >= profile[point + 1].t) {
+		point++;
+		if (point == 0 || profile[point].rpm != profile[point - 1].rpm) {
+			Type_Setpoint(profile[point].rpm);
+		}
+	}
+	board_motor.load = profile[point].load;
+	if (++ticks % decimation == 0) {
+		printf("%.4f,%d,%.1f,%d,%u,%.0f\n", t, des_rpm, Motor_RPM(&board_motor), cur_rpm,
+		       N, latency < 0 ? -1.0 : latency * 1e6 / SystemCoreClock);
+		if (latency > max_latency) {
+			max_latency = latency;
+		}
+		latency = -1;
+	}
+}
+
+int main(int argc, char **argv) {
+	FILE *in;
+	char line[256];
+	int arg = 1, fail;
+	clock_t start;
+	double cpu, seconds;
+	ADC_Stats stats;
+
+	if (argc > 2 && strcmp(argv[1], "-d") == 0) {
+		decimation = atol(argv[2]);
+		arg = 3;
+	}
+	if (argc != arg + 1 || decimation < 1) {
+		fprintf(stderr, "usage: %s [-d decimation] profile.csv > trace.csv\n", argv[0]);
+		return 2;
+	}
+	in = fopen(argv[arg], "r");
+	if (in == NULL) {
+		perror(argv[arg]);
+		return 1;
+	}
+	while (points < MAX_PROFILE && fgets(line, sizeof(line), in)) {
+		if (sscanf(line, "%lf , %d , %lf", &profile[points].t, &profile[points].rpm, &profile[points].load) == 3) {
+			points++;
+		}
+	}
+	fclose(in);
+	if (points < 2) {
+		fprintf(stderr, "%s: need at least two profile lines\n", argv[arg]);
+		return 1;
+	}
+
+	TM4C_Init();
+	board_tick = Tick;
+	board_tick_cycles = SystemCoreClock / TICK_HZ;
+	board_end = (uint64_t)(profile[points - 1].t * SystemCoreClock);
+	Board_Init();
+	tm4c_pwm_access = PWM_Access;
+
+	start = clock();
+	printf("time,setpoint,rpm,measured,duty,latency_us\n");
+	TM4C_Reset(Firmware_Main);
+	cpu = (double)(clock() - start) / CLOCKS_PER_SEC;
+	seconds = (double)tm4c_cycles / SystemCoreClock;
+
+	ADC_GetStats(&stats);
+	fprintf(stderr, "%.1f s simulated in %.2f s (%.0fx real time)\n",
+	        seconds, cpu, cpu > 0 ? seconds / cpu : 0);
+	fprintf(stderr, "conversions %u, missed %u, busy not ready %u, ring overruns %u\n",
+	        stats.conversions, stats.missed_conversions, stats.busy_not_ready, stats.ring_overruns);
+	fprintf(stderr, "control deadline misses %u, deferred signals lost %u, max latency %.0f us\n",
+	        control_deadline_misses, DeferredLost,
+	        max_latency < 0 ? -1.0 : max_latency * 1e6 / SystemCoreClock);
+	fprintf(stderr, "LCD |%s|\n    |%s|\n", board_lcd[0], board_lcd[1]);
+	fail = stats.missed_conversions || stats.busy_not_ready || stats.ring_overruns ||
+	       control_deadline_misses || DeferredLost;
+	return fail;
+}
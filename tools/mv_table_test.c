@@ -0,0 +1,61 @@
+// mv_table_test.c
+// Host tool, not part of the Keil project.
+// Checks Millivolt_Table against the Sample_to_Millivolts it replaced,
+// copied below as Old_Sample_to_Millivolts, for every 12-bit code. In
+// 12-bit mode every code must match. In 8-bit mode the ADC only
+// produces codes with the 4 LSBs clear, and those must match; any other
+// code must give the value of the code with its 4 LSBs cleared.
+//
+// Build:  gcc -O2 -I. -o mv_table_test tools/mv_table_test.c Sample_Process.c
+//             Filter.c Observer.c Voltage2RPM.c
+//         Add -DADC_12BIT=1 to check the 12-bit table, and
+//         -DADC_CALIBRATION=1 to check it with the nominal calibration.
+// Usage:  mv_table_test
+//
+// Prints the mode and the number of codes checked. The exit status is 1
+// at the first code that differs.
+
+#include <stdio.h>
+#include <stdint.h>
+#include "Sample_Process.h"
+
+// Sample_to_Millivolts before the table, unchanged
+static int32_t Old_Sample_to_Millivolts(int32_t sample) {
+	int32_t retVal;
+	int32_t temp;
+	uint32_t scale_constant = 205; // 205 sample ticks = 1 V
+	if (sample & 0x00000800) {
+		// sample is negative in two's complement, copy sign bit over
+		temp = 0 - (sample);
+	} else {
+		// sample is positive in two's complement, copy sign bit over
+		temp = sample;
+	}
+
+	// project sample range onto signal's voltage range
+	retVal = (1000 * temp) / scale_constant; // millivolts
+	return retVal;
+}
+
+int main(void) {
+	int32_t code, expect, table;
+	uint32_t exact = 0;
+
+#if ADC_CALIBRATION
+	ADC_SetCalibration(65536, 0); // nominal, so only the table is compared
+#endif
+	for (code = 0; code < 4096; code++) {
+		expect = Old_Sample_to_Millivolts(code & ~((1 << ADC_CODE_SHIFT) - 1));
+		table = Sample_to_Millivolts(code);
+		if (table != expect) {
+			fprintf(stderr, "code 0x%03X: table %d, old %d\n", code, table, expect);
+			return 1;
+		}
+		if ((code & ((1 << ADC_CODE_SHIFT) - 1)) == 0) {
+			exact++;
+		}
+	}
+	printf("%d-bit mode, %u ADC codes match, 4096 codes checked\n",
+		ADC_12BIT ? 12 : 8, exact);
+	return 0;
+}
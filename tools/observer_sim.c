@@ -0,0 +1,122 @@
+// observer_sim.c
+// Host tool, not part of the Keil project.
+// Compares the two voltage-based speed estimates Sample_Process keeps,
+// the moving average through Current_speed and the observer in
+// Observer.c, against the true speed of the motor model. The loop in
+// sim.c runs through setpoint steps and a load step, closed on the
+// source SPEED_OBSERVER selects, and both estimates are read at every
+// control iteration.
+//
+// Build:  gcc -O2 -I. -o observer_sim tools/observer_sim.c tools/sim.c
+//             tools/motor_model.c Sample_Process.c Filter.c Observer.c
+//             PID.c Speed_Control.c Voltage2RPM.c -lm
+//         Add -DADC_12BIT=1 or -DSPEED_OBSERVER=1 as in the firmware.
+// Usage:  observer_sim [noise_mV] > report.csv
+//
+// noise_mV is the rms noise at the ADC input, default 20. The report has
+// CSV lines "estimator,lag_ms,bias_rpm,noise_rpm,rms_error_rpm":
+//   lag_ms         the delay of the true speed that best matches the
+//                  estimate over the whole run
+//   bias_rpm       mean error over the second half of every hold
+//   noise_rpm      standard deviation of the error there, about the
+//                  mean of each hold
+//   rms_error_rpm  over the whole run, steps included
+// The true speed is sampled as is, so its PWM ripple counts as noise
+// for both estimates. The exit status is 1 if the observer lags more or
+// is noisier than the average.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+#include "sim.h"
+#include "Voltage2RPM.h"
+
+#define MAX_LAG	100   // control periods searched for the lag
+
+typedef struct {
+	int32_t rpm;
+	double load;          // N*m
+	int periods;          // control periods held
+} Hold;
+
+static const Hold holds[] = {
+	{1200, 0, 1500},
+	{2400, 0, 1500},
+	{ 800, 0, 1500},
+	{1600, 0, 1500},
+	{1600, 0.01, 1500},
+	{ 500, 0, 1500},
+};
+#define NUM_HOLDS	(sizeof(holds) / sizeof(holds[0]))
+#define NUM_ESTIMATORS	2
+
+static const char *names[NUM_ESTIMATORS] = {"average", "observer"};
+
+int main(int argc, char **argv) {
+	static double truth[NUM_HOLDS * 1500], est[NUM_ESTIMATORS][NUM_HOLDS * 1500];
+	double noise = 0.020;
+	double lag_ms[NUM_ESTIMATORS], noise_rpm[NUM_ESTIMATORS];
+	unsigned h;
+	int n = 0, k, e, d;
+	Sim sim;
+
+	if (argc > 1) {
+		noise = atof(argv[1]) / 1000;
+	}
+	Sim_Init(&sim);
+	sim.motor.sense_noise = noise;
+	for (h = 0; h < NUM_HOLDS; h++) {
+		sim.des_rpm = holds[h].rpm;
+		sim.motor.load = holds[h].load;
+		for (k = 0; k < holds[h].periods; k++) {
+			Sim_Control_Period(&sim);
+			truth[n] = Motor_RPM(&sim.motor);
+			est[0][n] = Current_speed(average_millivolts);
+			est[1][n] = Observer_Speed(&speed_observer);
+			n++;
+		}
+	}
+
+	printf("estimator,lag_ms,bias_rpm,noise_rpm,rms_error_rpm\n");
+	for (e = 0; e < NUM_ESTIMATORS; e++) {
+		double best = INFINITY, sum = 0, sq = 0, err_sq = 0;
+		int lag = 0, count = 0, start = 0;
+
+		for (d = 0; d <= MAX_LAG; d++) {
+			double mse = 0;
+			for (k = MAX_LAG; k < n; k++) {
+				mse += (est[e][k] - truth[k - d]) * (est[e][k] - truth[k - d]);
+			}
+			if (mse < best) {
+				best = mse;
+				lag = d;
+			}
+		}
+		for (h = 0; h < NUM_HOLDS; h++) {
+			double hold_sum = 0, hold_mean;
+			int first = start + holds[h].periods / 2, end = start + holds[h].periods;
+			for (k = first; k < end; k++) {
+				hold_sum += est[e][k] - truth[k];
+			}
+			hold_mean = hold_sum / (end - first);
+			for (k = first; k < end; k++) {
+				sq += (est[e][k] - truth[k] - hold_mean) * (est[e][k] - truth[k] - hold_mean);
+			}
+			sum += hold_sum;
+			count += end - first;
+			start = end;
+		}
+		for (k = 0; k < n; k++) {
+			err_sq += (est[e][k] - truth[k]) * (est[e][k] - truth[k]);
+		}
+		lag_ms[e] = lag * 1000.0 / SIM_CONTROL_RATE;
+		noise_rpm[e] = sqrt(sq / count);
+		printf("%s,%.1f,%.1f,%.1f,%.1f\n", names[e], lag_ms[e],
+		       sum / count, noise_rpm[e], sqrt(err_sq / n));
+	}
+	if (lag_ms[1] > lag_ms[0] || noise_rpm[1] > noise_rpm[0]) {
+		fprintf(stderr, "the observer is no better than the average\n");
+		return 1;
+	}
+	return 0;
+}
@@ -0,0 +1,273 @@
+// pid_test.c
+// Host tool, not part of the Keil project.
+// Checks the fixed-point PID.c and Speed_Control.c against the same
+// control law in double precision, and times them against the double
+// loop Controller() ran before.
+//
+// Build:  gcc -O2 -I. -o pid_test tools/pid_test.c PID.c Speed_Control.c
+// Usage:  pid_test > report.csv
+//
+// The report has CSV lines "case,iterations,max_error" for the checks,
+// where max_error is in duty counts, then "loop,ns" for the timing.
+// The checks:
+//   sweep    Speed_Control_Step over every setpoint and measurement
+//            pair of a grid, the controller reset before each pair
+//   trace    Speed_Control_Step along a pseudo-random speed trace
+//   pid      PID_Update with integral and filtered derivative gains,
+//            along the same trace, so the anti-windup and the filter
+//            state are checked too
+//   gains    as pid, with PID_SetGains every 500 iterations
+// The reference gains are the Q16.16 values, so only the arithmetic is
+// compared. The fixed-point output is truncated to whole counts, so it
+// may be up to 1 count below the reference, plus the rounding of the
+// Q16.16 integral and filter state. The exit status is 1 if any check
+// is off by more than MAX_ERROR counts.
+// The timing runs the old double loop and Speed_Control_Step on the same
+// inputs. The host has a double-precision FPU, so it understates what
+// the fixed-point loop saves on the board, where every double operation
+// is a soft-float library call. ControllerCycles in rtos_v2.c has the
+// board's cycle count.
+
+#include <stdio.h>
+#include <stdint.h>
+#include <time.h>
+#include "PID.h"
+#include "Speed_Control.h"
+
+#define MAX_ERROR	1.01
+#define TRACE_LENGTH	200000
+#define BENCH_ROUNDS	2000000
+
+typedef struct {
+	double kP, kI, kD, dAlpha;
+	double integral, dFilt, prevMeas, prevError;
+	double outMin, outMax;
+} Ref_PID;
+
+static double Q16(int32_t x) {
+	return x / 65536.0;
+}
+
+static double Ref_Clamp(Ref_PID *r, double v) {
+	if (v > r->outMax) return r->outMax;
+	if (v < r->outMin) return r->outMin;
+	return v;
+}
+
+static void Ref_Init(Ref_PID *r, PID_Type *pid) {
+	r->kP = Q16(pid->kP);
+	r->kI = Q16(pid->kI);
+	r->kD = Q16(pid->kD);
+	r->dAlpha = Q16(pid->dAlpha);
+	r->outMin = pid->outMin;
+	r->outMax = pid->outMax;
+	r->integral = 0;
+	r->dFilt = 0;
+	r->prevMeas = 0;
+	r->prevError = 0;
+}
+
+static void Ref_Reset(Ref_PID *r, double meas) {
+	r->integral = 0;
+	r->dFilt = 0;
+	r->prevMeas = meas;
+	r->prevError = 0;
+}
+
+// PID_SetGains in double precision
+static void Ref_SetGains(Ref_PID *r, PID_Type *pid) {
+	double kP = Q16(pid->kP), kI = Q16(pid->kI), kD = Q16(pid->kD);
+	r->integral = Ref_Clamp(r, r->integral + (r->kP - kP) * r->prevError + (r->kD - kD) * r->dFilt);
+	r->kP = kP;
+	r->kI = kI;
+	r->kD = kD;
+}
+
+// PID_Update in double precision
+static double Ref_Update(Ref_PID *r, double setpoint, double meas, double feedforward) {
+	double error = setpoint - meas;
+	double p = r->kP * error;
+	double d, out;
+
+	r->dFilt += r->dAlpha * ((r->prevMeas - meas) - r->dFilt);
+	d = r->kD * r->dFilt;
+	r->prevMeas = meas;
+	r->prevError = error;
+
+	out = p + r->integral + d + feedforward;
+	if (!((out >= r->outMax && error > 0) || (out <= r->outMin && error < 0))) {
+		r->integral = Ref_Clamp(r, r->integral + r->kI * error);
+		out = p + r->integral + d + feedforward;
+	}
+	return Ref_Clamp(r, out);
+}
+
+// Speed_Control_Step in double precision
+static double Ref_Step(Ref_PID *r, int32_t des_rpm, int32_t cur_rpm) {
+	if (des_rpm == 0) {
+		Ref_Reset(r, cur_rpm);
+		return 0;
+	}
+	return Ref_Update(r, des_rpm, cur_rpm, (des_rpm < CONTROL_KF) ? 0 : CONTROL_KF);
+}
+
+static double Error(int32_t fixed, double ref) {
+	double e = ref - fixed;
+	return (e < 0) ? -e : e;
+}
+
+// speed trace: setpoint steps every 1000 iterations, and a measurement
+// that follows it with noise
+static uint32_t seed;
+
+static int32_t Random(int32_t n) {
+	seed = seed * 1664525 + 1013904223;
+	return (int32_t)((seed >> 8) % (uint32_t)n);
+}
+
+static void Trace_Next(uint32_t i, int32_t *des_rpm, int32_t *cur_rpm) {
+	static const int32_t setpoints[] = {0, 400, 2400, 1200, 499, 500, 1800, 0, 2400};
+	if (i % 1000 == 0) {
+		*des_rpm = setpoints[(i / 1000) % (sizeof(setpoints) / sizeof(setpoints[0]))];
+	}
+	*cur_rpm += (*des_rpm - *cur_rpm) / 50 + Random(41) - 20;
+	if (*cur_rpm < 0) {
+		*cur_rpm = 0;
+	}
+}
+
+static double Check_Sweep(unsigned long *n) {
+	PID_Type pid;
+	Ref_PID ref;
+	int32_t des_rpm, cur_rpm;
+	double e, max = 0;
+
+	*n = 0;
+	for (des_rpm = 0; des_rpm <= 3000; des_rpm += 25) {
+		for (cur_rpm = 0; cur_rpm <= 3000; cur_rpm += 10) {
+			Speed_Control_Init(&pid);
+			Ref_Init(&ref, &pid);
+			PID_Reset(&pid, cur_rpm);
+			Ref_Reset(&ref, cur_rpm);
+			e = Error(Speed_Control_Step(&pid, des_rpm, cur_rpm), Ref_Step(&ref, des_rpm, cur_rpm));
+			if (e > max) max = e;
+			++*n;
+		}
+	}
+	return max;
+}
+
+static double Check_Trace(void) {
+	PID_Type pid;
+	Ref_PID ref;
+	int32_t des_rpm = 0, cur_rpm = 0;
+	double e, max = 0;
+	uint32_t i;
+
+	Speed_Control_Init(&pid);
+	Ref_Init(&ref, &pid);
+	seed = 1;
+	for (i = 0; i < TRACE_LENGTH; i++) {
+		Trace_Next(i, &des_rpm, &cur_rpm);
+		e = Error(Speed_Control_Step(&pid, des_rpm, cur_rpm), Ref_Step(&ref, des_rpm, cur_rpm));
+		if (e > max) max = e;
+	}
+	return max;
+}
+
+// the full PID law, gains changed on the fly if change_gains is set
+static double Check_PID(int change_gains) {
+	static const int32_t gains[][3] = {
+		{PID_Q16(0.75), PID_Q16(0.02), PID_Q16(2.0)},
+		{PID_Q16(1.5), PID_Q16(0.005), PID_Q16(0.5)},
+		{PID_Q16(0.3), PID_Q16(0.05), 0},
+	};
+	PID_Type pid;
+	Ref_PID ref;
+	int32_t des_rpm = 0, cur_rpm = 0;
+	double e, max = 0;
+	uint32_t i, g;
+
+	PID_Init(&pid, gains[0][0], gains[0][1], gains[0][2], PID_ONE / 4, 0, CONTROL_MAX_DUTY);
+	Ref_Init(&ref, &pid);
+	seed = 2;
+	for (i = 0; i < TRACE_LENGTH; i++) {
+		Trace_Next(i, &des_rpm, &cur_rpm);
+		if (change_gains && i % 500 == 499) {
+			g = (i / 500) % 3;
+			PID_SetGains(&pid, gains[g][0], gains[g][1], gains[g][2]);
+			Ref_SetGains(&ref, &pid);
+		}
+		e = Error(PID_Update(&pid, des_rpm, cur_rpm, CONTROL_KF),
+		          Ref_Update(&ref, des_rpm, cur_rpm, CONTROL_KF));
+		if (e > max) max = e;
+	}
+	return max;
+}
+
+static double Now_ns(void) {
+	struct timespec t;
+	clock_gettime(CLOCK_MONOTONIC, &t);
+	return t.tv_sec * 1e9 + t.tv_nsec;
+}
+
+// the loop body of Controller() before the fixed-point PID
+static int32_t Old_Step(int32_t des_rpm, int32_t cur_rpm) {
+	double kF = 500;
+	double kP = 0.75;
+	int32_t N = kP * (des_rpm - cur_rpm) + kF;
+	if (N >= 2500)
+		N = 2500;
+	else if (N <= 0 || des_rpm == 0)
+		N = 0;
+	else if (des_rpm < kF)
+		N = N - kF;
+	return N;
+}
+
+int main(void) {
+	static volatile int32_t des[64], cur[64];
+	volatile uint32_t sink = 0;
+	PID_Type pid;
+	unsigned long n;
+	double sweep, trace, full, gains, t0, old_ns, new_ns;
+	uint32_t i;
+	int fail;
+
+	sweep = Check_Sweep(&n);
+	trace = Check_Trace();
+	full = Check_PID(0);
+	gains = Check_PID(1);
+	printf("case,iterations,max_error\n");
+	printf("sweep,%lu,%.3f\n", n, sweep);
+	printf("trace,%u,%.3f\n", TRACE_LENGTH, trace);
+	printf("pid,%u,%.3f\n", TRACE_LENGTH, full);
+	printf("gains,%u,%.3f\n", TRACE_LENGTH, gains);
+	fail = (sweep > MAX_ERROR) || (trace > MAX_ERROR) || (full > MAX_ERROR) || (gains > MAX_ERROR);
+
+	seed = 3;
+	for (i = 0; i < 64; i++) {
+		des[i] = 400 + Random(2001);
+		cur[i] = Random(2800);
+	}
+	t0 = Now_ns();
+	for (i = 0; i < BENCH_ROUNDS; i++) {
+		sink += Old_Step(des[i & 63], cur[i & 63]);
+	}
+	old_ns = (Now_ns() - t0) / BENCH_ROUNDS;
+	Speed_Control_Init(&pid);
+	t0 = Now_ns();
+	for (i = 0; i < BENCH_ROUNDS; i++) {
+		sink += Speed_Control_Step(&pid, des[i & 63], cur[i & 63]);
+	}
+	new_ns = (Now_ns() - t0) / BENCH_ROUNDS;
+	printf("loop,ns\n");
+	printf("double,%.1f\n", old_ns);
+	printf("fixed,%.1f\n", new_ns);
+	(void)sink;
+
+	if (fail) {
+		fprintf(stderr, "fixed-point PID is off the double reference by more than %.2f counts\n", MAX_ERROR);
+	}
+	return fail;
+}
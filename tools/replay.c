@@ -0,0 +1,216 @@
+// replay.c
+// Host tool, not part of the Keil project.
+// Replays a recording made with RECORDER (see Record_Format.h) through the
+// firmware's own Sample_Process.c and Speed_Control.c. Every control
+// iteration is checked: the speed recomputed from the recorded samples
+// against the speed the board used, and the duty recomputed from that
+// speed and the setpoint against the duty the board set.
+//
+// Build:  gcc -O2 -I. -o replay tools/replay.c Sample_Process.c Filter.c
+//             Observer.c Voltage2RPM.c PID.c Speed_Control.c
+//         Use the same ADC_12BIT, ADC_PWM_SYNC, SPEED_OBSERVER and
+//         SPEED_ENCODER settings as the firmware that made the recording.
+// Capture: stty -F /dev/ttyACM0 1000000 raw && cat /dev/ttyACM0 > run.rec
+// Usage:  replay run.rec              summary
+//         replay -t run.rec > t.csv   also a CSV trace of every control iteration
+//
+// The exit status is 1 if any iteration does not match.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "Record_Format.h"
+#include "Sample_Process.h"
+#include "Speed_Control.h"
+#include "Voltage2RPM.h"
+#include "Encoder.h"
+
+#define CLOCK_HZ	16000000.0  // bus clock of the recording
+#define ADC_DEFAULT_RATE	10000   // as in ADC.h
+#define MAX_PENDING	4096        // recorded samples not yet processed
+
+// values are clamped like this when recorded
+static int32_t Clamp12(int32_t v) {
+	if (v < 0) return 0;
+	if (v > 0xFFF) return 0xFFF;
+	return v;
+}
+
+static double Now_ns(void) {
+	struct timespec t;
+	clock_gettime(CLOCK_MONOTONIC, &t);
+	return t.tv_sec * 1e9 + t.tv_nsec;
+}
+
+int main(int argc, char **argv) {
+	const char *path;
+	int trace = 0;
+	FILE *in;
+	uint8_t bytes[4];
+	uint32_t word;
+	long offset = 0;
+
+	// replay state
+	int32_t pending[MAX_PENDING];
+	uint32_t head = 0, tail = 0;
+	uint64_t time = 0;
+	int32_t des_rpm = 0, duty = 0, speed = 0, n = 0;
+	int control_open = 0;
+	PID_Type pid;
+
+	// results
+	unsigned long samples = 0, controls = 0, keys = 0, drops = 0;
+	unsigned long speed_mismatches = 0, duty_mismatches = 0, lost_sync = 0;
+	double sample_ns = 0, control_ns = 0;
+
+	if (argc == 3 && strcmp(argv[1], "-t") == 0) {
+		trace = 1;
+		path = argv[2];
+	} else if (argc == 2) {
+		path = argv[1];
+	} else {
+		fprintf(stderr, "usage: %s [-t] recording\n", argv[0]);
+		return 2;
+	}
+	in = fopen(path, "rb");
+	if (in == NULL) {
+		perror(path);
+		return 2;
+	}
+
+	// the capture may start mid-stream, skip to the first REC_START
+	word = 0;
+	for (;;) {
+		int c = fgetc(in);
+		if (c == EOF) {
+			fprintf(stderr, "%s: no REC_START found\n", path);
+			return 2;
+		}
+		word = (word >> 8) | ((uint32_t)c << 24);
+		if (++offset >= 4 && word == ((REC_START << 28) | (RECORDER_VERSION << 16) | RECORDER_MAGIC)) {
+			break;
+		}
+	}
+
+	Sample_Process_Init(ADC_DEFAULT_RATE);
+	Speed_Control_Init(&pid);
+	if (trace) {
+		printf("time_s,des_rpm,speed,replayed_speed,duty,replayed_duty\n");
+	}
+
+	while (fread(bytes, 1, 4, in) == 4) {
+		uint32_t type, value, data;
+		word = bytes[0] | (bytes[1] << 8) | (bytes[2] << 16) | ((uint32_t)bytes[3] << 24);
+		type = word >> 28;
+		value = (word >> 16) & 0xFFF;
+		data = word & 0xFFFF;
+		if (type != REC_START && type != REC_RATE) {
+			time += data;
+		}
+
+		switch (type) {
+		case REC_START:
+			fprintf(stderr, "restart at %.6f s\n", time / CLOCK_HZ);
+			Sample_Process_Init(ADC_DEFAULT_RATE);
+			Speed_Control_Init(&pid);
+			head = tail = 0;
+			des_rpm = 0;
+			control_open = 0;
+			break;
+		case REC_RATE:
+			Sample_Process_SetRate(data, value);
+			break;
+		case REC_GAP:
+			time += (uint64_t)value << 16;
+			break;
+		case REC_DROP:
+			drops += value;
+			break;
+		case REC_SAMPLE:
+			++samples;
+			if (head - tail < MAX_PENDING) {
+				pending[head++ % MAX_PENDING] = value;
+			}
+			break;
+		case REC_KEY:
+			++keys;
+			break;
+		case REC_SETPOINT:
+			des_rpm = value;
+			break;
+		case REC_CONTROL: {
+			// process the samples the board had processed when it ran
+			double t0 = Now_ns();
+			while ((processed_samples & 0xFFF) != value && tail != head) {
+				Sample_Process(pending[tail++ % MAX_PENDING], duty);
+			}
+			sample_ns += Now_ns() - t0;
+			if ((processed_samples & 0xFFF) != value) {
+				++lost_sync;
+				processed_samples = (processed_samples & ~0xFFFu) | value;
+			}
+#if SPEED_ENCODER
+			speed = 0; // the encoder is not recorded, nothing to check
+#elif SPEED_OBSERVER
+			speed = Observer_Speed(&speed_observer);
+#else
+			speed = Current_speed(average_millivolts);
+#endif
+			control_open = 1;
+			break;
+		}
+		case REC_SPEED: {
+			double t0;
+			if (!control_open) break;
+			++controls;
+			if (!SPEED_ENCODER && Clamp12(speed) != (int32_t)value) {
+				++speed_mismatches;
+			}
+			// the controller is replayed with the recorded speed so it
+			// is checked even when the speed pipeline is not
+			t0 = Now_ns();
+			n = Speed_Control_Step(&pid, des_rpm, value);
+			control_ns += Now_ns() - t0;
+			if (trace) {
+				printf("%.6f,%d,%u,%d,", time / CLOCK_HZ, des_rpm, value, speed);
+			}
+			break;
+		}
+		case REC_DUTY:
+			if (control_open) {
+				if (Clamp12(n) != (int32_t)value) {
+					++duty_mismatches;
+				}
+				if (trace) {
+					printf("%u,%d\n", value, n);
+				}
+				control_open = 0;
+			}
+			duty = value; // used by the observer from now on
+			break;
+		default:
+			fprintf(stderr, "unknown record type %u at %.6f s\n", type, time / CLOCK_HZ);
+			break;
+		}
+	}
+	fclose(in);
+
+	fprintf(stderr, "%.3f s recorded: %lu samples, %lu control iterations, %lu keys\n",
+	        time / CLOCK_HZ, samples, controls, keys);
+	fprintf(stderr, "records dropped on the board: %lu\n", drops);
+	fprintf(stderr, "control iterations out of sample sync: %lu\n", lost_sync);
+#if SPEED_ENCODER
+	fprintf(stderr, "speed mismatches: not checked, encoder speed is not recorded\n");
+#else
+	fprintf(stderr, "speed mismatches: %lu\n", speed_mismatches);
+#endif
+	fprintf(stderr, "duty mismatches: %lu\n", duty_mismatches);
+	if (samples) {
+		fprintf(stderr, "host ns per Sample_Process: %.1f\n", sample_ns / samples);
+	}
+	if (controls) {
+		fprintf(stderr, "host ns per Speed_Control_Step: %.1f\n", control_ns / controls);
+	}
+	return (speed_mismatches || duty_mismatches || lost_sync) ? 1 : 0;
+}
@@ -0,0 +1,109 @@
+// ring_stress.c
+// Host tool, not part of the Keil project.
+// Stress test of the lock-free ring in Sample_Ring.c with a real
+// producer thread standing in for GPIOC_Handler and a consumer thread
+// standing in for ADC_Process. The producer numbers the samples it
+// manages to put and stamps each with a matching time. The consumer
+// must see exactly 0, 1, 2, ... with matching times, so a lost,
+// repeated, reordered or torn entry is caught. The consumer pauses now
+// and then so the ring fills, and every failed put must be counted in
+// overruns. A thread that cannot go on yields, so the test also runs
+// on a single core, where the threads interleave at preemption.
+//
+// Build:  gcc -O2 -pthread -I. -Itools/host -o ring_stress
+//             tools/ring_stress.c Sample_Ring.c
+// Usage:  ring_stress [samples]
+//
+// Prints the samples passed, the overruns and the high-water mark. The
+// exit status is 1 on the first error.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <pthread.h>
+#include <sched.h>
+#include "Sample_Ring.h"
+
+#define DEFAULT_SAMPLES	20000000u
+#define TIME_OF(n)	((n) * 2654435761u)  // differs from the sample in every bit position
+
+static SampleRing ring;
+static uint32_t samples = DEFAULT_SAMPLES;
+static volatile int producer_done = 0;
+static uint32_t failed_puts = 0;
+
+static void *Producer(void *arg) {
+	uint32_t n = 0;
+	(void)arg;
+	while (n < samples) {
+		if (SampleRing_Put(&ring, (int32_t)n, TIME_OF(n)) == 0) {
+			n++;
+		} else {
+			failed_puts++;
+			sched_yield();            // full, give the consumer a turn
+		}
+	}
+	__sync_synchronize();
+	producer_done = 1;
+	return 0;
+}
+
+static void *Consumer(void *arg) {
+	ADC_Sample s;
+	uint32_t expect = 0, seed = 1, spin;
+	long error = 0;
+	(void)arg;
+	while (expect < samples) {
+		if (!SampleRing_Get(&ring, &s)) {
+			if (producer_done && SampleRing_Count(&ring) == 0 && expect < samples) {
+				fprintf(stderr, "ring empty after %u of %u samples\n", expect, samples);
+				error = 1;
+				break;
+			}
+			sched_yield();
+			continue;
+		}
+		if ((uint32_t)s.sample != expect || s.time != TIME_OF(expect)) {
+			fprintf(stderr, "got sample %d time %u, expected %u time %u\n",
+				s.sample, s.time, expect, TIME_OF(expect));
+			error = 1;
+			break;
+		}
+		expect++;
+		seed = seed * 1664525 + 1013904223;
+		if ((seed >> 24) == 0) {          // about one in 256, let the ring fill
+			for (spin = 0; spin < (seed & 0xFFFF); spin++) {
+				__asm__ volatile("" ::: "memory");
+			}
+		}
+	}
+	return (void *)error;
+}
+
+int main(int argc, char **argv) {
+	pthread_t producer, consumer;
+	void *error;
+
+	if (argc > 1) {
+		samples = (uint32_t)strtoul(argv[1], 0, 0);
+	}
+	SampleRing_Init(&ring);
+	pthread_create(&consumer, 0, Consumer, 0);
+	pthread_create(&producer, 0, Producer, 0);
+	pthread_join(producer, 0);
+	pthread_join(consumer, &error);
+	if (error) {
+		return 1;
+	}
+	if (ring.overruns != failed_puts) {
+		fprintf(stderr, "%u overruns counted, %u puts failed\n", ring.overruns, failed_puts);
+		return 1;
+	}
+	if (ring.high_water > SAMPLE_RING_SIZE || SampleRing_Count(&ring) != 0) {
+		fprintf(stderr, "high water %u, %u left in the ring\n", ring.high_water, SampleRing_Count(&ring));
+		return 1;
+	}
+	printf("%u samples in order, %u overruns, high water %u of %u\n",
+		samples, ring.overruns, ring.high_water, SAMPLE_RING_SIZE);
+	return 0;
+}
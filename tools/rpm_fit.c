@@ -0,0 +1,150 @@
+// rpm_fit.c
+// Host tool, not part of the Keil project.
+// Fits the piecewise-linear voltage to RPM map used by Current_speed
+// to logged data and writes RPM_Table.h.
+//
+// Build:  gcc -O2 -o rpm_fit tools/rpm_fit.c -lm
+// Usage:  rpm_fit log.csv [cutoff_mV] > RPM_Table.h
+//
+// Each line of the CSV is "millivolts,rpm" from average_millivolts and a
+// tachometer. Lines that do not start with two numbers (headers) are
+// skipped. Current_speed returns 0 below cutoff_mV, default 1200 as in
+// the original fit, so points below it are left out of the fit. The
+// table values minimize the squared RPM error of the linear
+// interpolation, with a small second-difference penalty so breakpoints
+// with little or no data follow their neighbours.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <math.h>
+
+#define RPM_TABLE_SHIFT	8   // keep in step with RPM_Table.h
+#define RPM_TABLE_SIZE	41
+#define SMOOTHING	1e-3  // weight of the second-difference penalty
+#define CUTOFF_MV	1200  // default RPM_CUTOFF_MV
+
+static double A[RPM_TABLE_SIZE][RPM_TABLE_SIZE]; // normal equations
+static double b[RPM_TABLE_SIZE];
+static double x[RPM_TABLE_SIZE];
+static double cutoff = CUTOFF_MV;
+
+// adds one (mV, RPM) observation to the normal equations
+static void add_point(double mv, double rpm) {
+	double pos = mv / (1 << RPM_TABLE_SHIFT);
+	int i = (int)pos;
+	double w;
+
+	if (mv < cutoff) return;
+	if (i >= RPM_TABLE_SIZE - 1) {
+		i = RPM_TABLE_SIZE - 2;
+		pos = RPM_TABLE_SIZE - 1;
+	}
+	w = pos - i; // weight of breakpoint i+1
+
+	A[i][i]         += (1 - w) * (1 - w);
+	A[i][i + 1]     += (1 - w) * w;
+	A[i + 1][i]     += (1 - w) * w;
+	A[i + 1][i + 1] += w * w;
+	b[i]     += (1 - w) * rpm;
+	b[i + 1] += w * rpm;
+}
+
+// adds lambda * sum (x[i-1] - 2 x[i] + x[i+1])^2
+static void add_smoothing(double lambda) {
+	static const double d[3] = {1, -2, 1};
+	int i, j, k;
+
+	for (i = 1; i < RPM_TABLE_SIZE - 1; i++) {
+		for (j = 0; j < 3; j++) {
+			for (k = 0; k < 3; k++) {
+				A[i - 1 + j][i - 1 + k] += lambda * d[j] * d[k];
+			}
+		}
+	}
+}
+
+// Gaussian elimination with partial pivoting, A x = b
+static int solve(void) {
+	int i, j, k, p;
+
+	for (i = 0; i < RPM_TABLE_SIZE; i++) {
+		p = i;
+		for (j = i + 1; j < RPM_TABLE_SIZE; j++) {
+			if (fabs(A[j][i]) > fabs(A[p][i])) p = j;
+		}
+		if (fabs(A[p][i]) < 1e-12) return -1;
+		if (p != i) {
+			for (k = 0; k < RPM_TABLE_SIZE; k++) {
+				double t = A[i][k]; A[i][k] = A[p][k]; A[p][k] = t;
+			}
+			{ double t = b[i]; b[i] = b[p]; b[p] = t; }
+		}
+		for (j = i + 1; j < RPM_TABLE_SIZE; j++) {
+			double f = A[j][i] / A[i][i];
+			for (k = i; k < RPM_TABLE_SIZE; k++) A[j][k] -= f * A[i][k];
+			b[j] -= f * b[i];
+		}
+	}
+	for (i = RPM_TABLE_SIZE - 1; i >= 0; i--) {
+		double s = b[i];
+		for (k = i + 1; k < RPM_TABLE_SIZE; k++) s -= A[i][k] * x[k];
+		x[i] = s / A[i][i];
+	}
+	return 0;
+}
+
+int main(int argc, char **argv) {
+	FILE *in;
+	char line[256];
+	double mv, rpm;
+	int n = 0, i;
+
+	if (argc < 2 || argc > 3) {
+		fprintf(stderr, "usage: %s log.csv [cutoff_mV] > RPM_Table.h\n", argv[0]);
+		return 2;
+	}
+	if (argc == 3) {
+		cutoff = atof(argv[2]);
+	}
+	in = fopen(argv[1], "r");
+	if (in == NULL) {
+		perror(argv[1]);
+		return 1;
+	}
+	while (fgets(line, sizeof(line), in)) {
+		if (sscanf(line, "%lf , %lf", &mv, &rpm) == 2) {
+			add_point(mv, rpm);
+			n++;
+		}
+	}
+	fclose(in);
+	if (n < 2) {
+		fprintf(stderr, "%s: need at least two data points\n", argv[1]);
+		return 1;
+	}
+
+	add_smoothing(SMOOTHING * n / RPM_TABLE_SIZE);
+	if (solve() != 0) {
+		fprintf(stderr, "%s: data does not determine the table\n", argv[1]);
+		return 1;
+	}
+
+	printf("// RPM_Table.h\n");
+	printf("// Breakpoints of the motor voltage to RPM map used by Current_speed.\n");
+	printf("// Entry i is the speed at i << RPM_TABLE_SHIFT millivolts.\n");
+	printf("// Generated by tools/rpm_fit.c from %s (%d points).\n\n", argv[1], n);
+	printf("#ifndef RPM_TABLE_H\n#define RPM_TABLE_H\n\n#include <stdint.h>\n\n");
+	printf("#define RPM_TABLE_SHIFT\t%d   // %d mV between breakpoints\n",
+	       RPM_TABLE_SHIFT, 1 << RPM_TABLE_SHIFT);
+	printf("#define RPM_TABLE_SIZE\t%d  // covers 0 - %d mV\n",
+	       RPM_TABLE_SIZE, (RPM_TABLE_SIZE - 1) << RPM_TABLE_SHIFT);
+	printf("#define RPM_CUTOFF_MV\t%ld  // below this the motor is taken as stopped\n\n",
+	       lround(cutoff));
+	printf("static const int32_t RPM_Table[RPM_TABLE_SIZE] = {");
+	for (i = 0; i < RPM_TABLE_SIZE; i++) {
+		long v = lround(x[i] < 0 ? 0 : x[i]);
+		printf("%s%4ld%s", (i % 8) ? " " : "\n\t", v, (i < RPM_TABLE_SIZE - 1) ? "," : "");
+	}
+	printf("\n};\n\n#endif\n");
+	return 0;
+}
@@ -0,0 +1,131 @@
+// sema_bench.c
+// Host tool, not part of the Keil project.
+// Cost of OS_Signal waking a waiter as a function of the thread count:
+// the old search of the thread table for the highest priority thread
+// blocked on the semaphore, against the wait queue in Wait_Queue.c in
+// both orders. Every thread waits on the semaphore, with priorities
+// drawn from 0..7, and is signaled in turn until none is left.
+//
+// Build:  gcc -O2 -I. -o sema_bench tools/sema_bench.c Wait_Queue.c
+// Usage:  sema_bench > report.csv
+//
+// The report has CSV lines "threads,search_ns,priority_ns,fifo_ns,wait_ns",
+// times are per signal, and wait_ns is the WQ_PRIORITY put that OS_Wait
+// does. Each round is timed as a whole, so with few threads the time
+// includes a share of the clock reads. The exit status is 1 if the
+// search and WQ_PRIORITY wake the threads in a different priority order.
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stddef.h>
+#include <time.h>
+#include "Wait_Queue.h"
+
+#define MAX_THREADS	64
+#define PRIORITIES	8
+#define ROUNDS	20000
+
+typedef struct {
+	int32_t *blocked;
+	uint32_t priority;
+	WQ_Node WaitNode;
+} Thread;
+
+static Thread threads[MAX_THREADS];
+static int32_t Sem;
+static WaitQueue Waiters;
+static uint32_t order_search[MAX_THREADS], order_queue[MAX_THREADS];
+
+static double Now_ns(void) {
+	struct timespec t;
+	clock_gettime(CLOCK_MONOTONIC, &t);
+	return t.tv_sec * 1e9 + t.tv_nsec;
+}
+
+static void Set_Priorities(uint32_t n, uint32_t round) {
+	uint32_t i, seed = round + 1;
+	for (i = 0; i < n; i++) {
+		seed = seed * 1664525 + 1013904223;
+		threads[i].priority = (seed >> 16) % PRIORITIES;
+	}
+}
+
+// the search OS_Signal did before the wait queues
+static Thread *Signal_Search(uint32_t n) {
+	Thread *pt, *best = 0;
+	uint32_t i;
+	for (i = 0; i < n; i++) {
+		pt = &threads[i];
+		if ((pt->blocked == &Sem) && ((best == 0) || (pt->priority < best->priority))) {
+			best = pt;
+		}
+	}
+	best->blocked = 0;
+	return best;
+}
+
+static double Search(uint32_t n) {
+	double ns = 0, t0;
+	uint32_t i, k;
+	for (k = 0; k < ROUNDS; k++) {
+		Set_Priorities(n, k);
+		for (i = 0; i < n; i++) {
+			threads[i].blocked = &Sem;
+		}
+		t0 = Now_ns();
+		for (i = 0; i < n; i++) {
+			order_search[i] = Signal_Search(n)->priority;
+		}
+		ns += Now_ns() - t0;
+	}
+	return ns / ROUNDS / n;
+}
+
+static double Queue(uint32_t n, uint32_t policy, double *wait_ns) {
+	double ns = 0, put_ns = 0, t0;
+	uint32_t i, k;
+	WQ_Node *node;
+	for (k = 0; k < ROUNDS; k++) {
+		Set_Priorities(n, k);
+		WaitQueue_Init(&Waiters, policy);
+		t0 = Now_ns();
+		for (i = 0; i < n; i++) {
+			WaitQueue_Put(&Waiters, &threads[i].WaitNode, threads[i].priority);
+		}
+		put_ns += Now_ns() - t0;
+		t0 = Now_ns();
+		for (i = 0; i < n; i++) {
+			node = WaitQueue_Get(&Waiters);
+			order_queue[i] = ((Thread *)((char *)node - offsetof(Thread, WaitNode)))->priority;
+		}
+		ns += Now_ns() - t0;
+	}
+	if (wait_ns) {
+		*wait_ns = put_ns / ROUNDS / n;
+	}
+	return ns / ROUNDS / n;
+}
+
+int main(void) {
+	static const uint32_t counts[] = {4, 16, 64};
+	double search_ns, priority_ns, fifo_ns, wait_ns;
+	int fail = 0;
+	uint32_t c, i;
+
+	printf("threads,search_ns,priority_ns,fifo_ns,wait_ns\n");
+	for (c = 0; c < sizeof(counts) / sizeof(counts[0]); c++) {
+		search_ns = Search(counts[c]);
+		priority_ns = Queue(counts[c], WQ_PRIORITY, &wait_ns);
+		for (i = 0; i < counts[c]; i++) {  // the last round of each
+			if (order_search[i] != order_queue[i]) {
+				fprintf(stderr, "threads %u: wakeup %u has priority %u, search gave %u\n",
+					counts[c], i, order_queue[i], order_search[i]);
+				fail = 1;
+				break;
+			}
+		}
+		fifo_ns = Queue(counts[c], WQ_FIFO, 0);
+		printf("%u,%.1f,%.1f,%.1f,%.1f\n", counts[c], search_ns, priority_ns, fifo_ns, wait_ns);
+	}
+	return fail;
+}
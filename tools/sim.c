@@ -0,0 +1,54 @@
+// sim.c
+// Host tool, not part of the Keil project.
+// Closed-loop simulation of the speed controller. The sample path,
+// control law and speed conversion are the firmware's own
+// Sample_Process.c, Speed_Control.c and Voltage2RPM.c; only the ADC and
+// PWM hardware are modeled here. tools/motor_sim.c runs the whole
+// firmware instead; this is the quicker loop for the benchmarks.
+
+#include <string.h>
+#include "sim.h"
+#include "Speed_Control.h"
+#include "Voltage2RPM.h"
+
+// ******** Sim_Init ************
+// motor at rest, sample path and controller cleared, zero setpoint,
+// set up as Init_ADC and ADC_SetRate leave the firmware
+void Sim_Init(Sim *sim) {
+	memset(sim, 0, sizeof(*sim));
+	Motor_Init(&sim->motor);
+	Sample_Process_Init(SIM_ADC_RATE);
+	Sample_Process_SetRate(SIM_ADC_RATE, FILTER_CIC_SHIFT);
+	Speed_Control_Init(&sim->pid);
+}
+
+// ******** Sim_Control_Period ************
+// advances the simulation by one control period: the ADC samples and
+// motor steps in it, followed by one control iteration
+void Sim_Control_Period(Sim *sim) {
+	const double dt = (double)SIM_SUBSTEP_COUNTS / SIM_PWM_CLOCK;
+	int sample, step, on = 0;
+
+	for (sample = 0; sample < SIM_SAMPLES_PER_CONTROL; sample++) {
+		for (step = 0; step < SIM_SUBSTEPS_PER_SAMPLE; step++) {
+			on = Motor_PWM_Output(sim->pwm_count, sim->duty, SIM_PWM_PERIOD);
+			Motor_Step(&sim->motor, on, dt);
+			sim->pwm_count += SIM_SUBSTEP_COUNTS;
+			if (sim->pwm_count >= SIM_PWM_PERIOD) {
+				sim->pwm_count -= SIM_PWM_PERIOD;
+			}
+			sim->t += dt;
+		}
+
+		// ADC_Process
+		Sample_Process(Motor_ADC_Sample(&sim->motor, on, SIM_ADC_BITS), sim->duty);
+	}
+
+	// the speed source Controller() uses
+#if SPEED_OBSERVER
+	sim->meas_rpm = Observer_Speed(&speed_observer);
+#else
+	sim->meas_rpm = Current_speed(average_millivolts);
+#endif
+	sim->duty = Speed_Control_Step(&sim->pid, sim->des_rpm, sim->meas_rpm);
+}
@@ -0,0 +1,43 @@
+// sim.h
+// Host tool, not part of the Keil project.
+// Closed-loop simulation of the speed controller at the firmware's rates:
+// 10 kHz ADC conversions through Sample_Process, Current_speed and the
+// 1 kHz Speed_Control_Step, driving Motor_Model through the 100 Hz PWM.
+// Conversions are timed like Timer0A, so build it without ADC_PWM_SYNC.
+// Sample_Process keeps its state in globals, so run one Sim at a time.
+
+#ifndef SIM_H
+#define SIM_H
+
+#include <stdint.h>
+#include "motor_model.h"
+#include "PID.h"
+#include "Sample_Process.h"
+
+#if ADC_PWM_SYNC
+#error "sim.c times conversions like Timer0A, build it without ADC_PWM_SYNC"
+#endif
+
+#define SIM_PWM_CLOCK	250000  // PWM counts per second
+#define SIM_PWM_PERIOD	2500
+#define SIM_SUBSTEP_COUNTS	5   // PWM counts per integration step (20 us)
+#define SIM_SUBSTEPS_PER_SAMPLE	5   // 10 kHz ADC
+#define SIM_SAMPLES_PER_CONTROL	10  // 1 kHz control loop
+#define SIM_CONTROL_RATE	(SIM_PWM_CLOCK / (SIM_SUBSTEP_COUNTS * SIM_SUBSTEPS_PER_SAMPLE * SIM_SAMPLES_PER_CONTROL))
+#define SIM_ADC_RATE	(SIM_PWM_CLOCK / (SIM_SUBSTEP_COUNTS * SIM_SUBSTEPS_PER_SAMPLE))
+#define SIM_ADC_BITS	(ADC_12BIT ? 12 : 8)
+
+typedef struct {
+	Motor_Model motor;
+	PID_Type pid;
+	double t;                 // simulated seconds
+	uint32_t pwm_count;       // counts into the PWM period
+	int32_t des_rpm;          // setpoint
+	int32_t meas_rpm;         // speed seen by the controller
+	int32_t duty;             // commanded duty
+} Sim;
+
+void Sim_Init(Sim *sim);
+void Sim_Control_Period(Sim *sim);
+
+#endif
@@ -0,0 +1,256 @@
+// step_bench.c
+// Host tool, not part of the Keil project.
+// Closed-loop step-response benchmark of the speed controller, run on
+// the motor simulation in sim.c. Regressions past a baseline fail it.
+//
+// Build:  gcc -O2 -I. -o step_bench tools/step_bench.c tools/sim.c
+//             tools/motor_model.c Sample_Process.c Filter.c Observer.c
+//             PID.c Speed_Control.c Voltage2RPM.c -lm
+//         Use the same ADC_12BIT and SPEED_OBSERVER settings as the
+//         firmware being simulated.
+// Usage:  step_bench > report.csv                  just measure
+//         step_bench -c baseline.csv > report.csv  fail if worse than baseline
+//         step_bench -w 10 > baseline.csv          write a baseline with 10% margin
+//
+// The report and baseline are CSV lines "case,metric,value". Every metric
+// is better when lower, so a check fails when value > baseline value.
+// The speed is averaged over one PWM period to take out the ripple of
+// the 100 Hz PWM, which on its own is wider than the settling band.
+// Rise and settling are measured against the speed the loop ends at,
+// not the setpoint, since the loop may hold a steady-state error; that
+// error has its own metric. A case still outside the settling band in
+// the last tenth of the run reports "not_settled" for both, which fails
+// the check whatever the baseline says.
+// Keep tools/step_bench_baseline.csv up to date when the controller
+// is deliberately changed.
+// The exit status is 1 if any check fails.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+#include "sim.h"
+#include "Speed_Control.h"
+
+#define SETTLE_PERIODS	3000  // control periods to reach the initial state
+#define RECORD_PERIODS	6000  // control periods recorded after the step
+#define BAND	0.02          // settling band, fraction of the setpoint
+#define NOT_SETTLED	INFINITY  // printed as "not_settled"
+#define RIPPLE_PERIODS	(SIM_PWM_PERIOD * SIM_CONTROL_RATE / SIM_PWM_CLOCK) // control periods per PWM period
+#define MAX_RESULTS	64
+
+typedef struct {
+	const char *name;
+	int32_t from_rpm;
+	int32_t to_rpm;
+	double load;          // load torque applied at the step, N*m
+} Bench_Case;
+
+static const Bench_Case cases[] = {
+	{"step_0_400",       0,  400, 0},
+	{"step_400_2400",  400, 2400, 0},
+	{"step_2400_1200", 2400, 1200, 0},
+	{"load_1200",     1200, 1200, 0.01},
+};
+#define NUM_CASES	(sizeof(cases) / sizeof(cases[0]))
+
+typedef struct {
+	char name[64];
+	double value;
+} Result;
+
+static Result results[MAX_RESULTS];
+static int num_results = 0;
+
+static void report(const char *bench, const char *metric, double value) {
+	if (num_results < MAX_RESULTS) {
+		snprintf(results[num_results].name, sizeof(results[num_results].name), "%s,%s", bench, metric);
+		results[num_results].value = value;
+		num_results++;
+	}
+}
+
+// runs one case and reports its metrics
+static void run_case(const Bench_Case *c) {
+	static double rpm[RECORD_PERIODS];
+	const double dt = 1.0 / SIM_CONTROL_RATE;
+	double start, final, final_sum = 0, iae = 0, peak = 0, ripple_sum = 0;
+	double rise_lo = -1, rise_hi = -1, settle = 0;
+	double span = c->to_rpm - c->from_rpm;
+	int k, j, last_out = -1;
+	Sim sim;
+
+	Sim_Init(&sim);
+	sim.des_rpm = c->from_rpm;
+	for (k = 0; k < SETTLE_PERIODS; k++) {
+		Sim_Control_Period(&sim);
+	}
+	for (k = 0; k < RIPPLE_PERIODS; k++) {
+		Sim_Control_Period(&sim);
+		ripple_sum += Motor_RPM(&sim.motor);
+	}
+	start = ripple_sum / RIPPLE_PERIODS;
+
+	// rpm[k] is the true speed averaged over the PWM period up to k
+	sim.des_rpm = c->to_rpm;
+	sim.motor.load = c->load;
+	for (k = 0; k < RECORD_PERIODS; k++) {
+		Sim_Control_Period(&sim);
+		rpm[k] = Motor_RPM(&sim.motor);
+	}
+	for (k = RECORD_PERIODS - 1; k >= 0; k--) {
+		ripple_sum = 0;
+		for (j = 0; j < RIPPLE_PERIODS; j++) {
+			ripple_sum += (k >= j) ? rpm[k - j] : start;
+		}
+		rpm[k] = ripple_sum / RIPPLE_PERIODS;
+	}
+
+	for (k = RECORD_PERIODS * 9 / 10; k < RECORD_PERIODS; k++) {
+		final_sum += rpm[k];
+	}
+	final = final_sum / (RECORD_PERIODS - RECORD_PERIODS * 9 / 10);
+
+	for (k = 0; k < RECORD_PERIODS; k++) {
+		iae += fabs(c->to_rpm - rpm[k]) * dt;
+		if (span != 0) {
+			double frac = (rpm[k] - start) / (final - start);
+			if (rise_lo < 0 && frac >= 0.1) rise_lo = k * dt;
+			if (rise_hi < 0 && frac >= 0.9) rise_hi = k * dt;
+			if (frac - 1 > peak) peak = frac - 1;              // overshoot
+		} else if (fabs(c->to_rpm - rpm[k]) / c->to_rpm > peak) {
+			peak = fabs(c->to_rpm - rpm[k]) / c->to_rpm;       // disturbance dip
+		}
+		if (fabs(final - rpm[k]) > BAND * c->to_rpm) {
+			last_out = k;                                      // last time outside the band
+		}
+	}
+	if (last_out >= RECORD_PERIODS * 9 / 10) {
+		settle = NOT_SETTLED;                                  // still moving at the end
+	} else {
+		settle = (last_out + 1) * dt;
+	}
+
+	if (span != 0) {
+		report(c->name, "rise_time_s", (settle == NOT_SETTLED || rise_lo < 0 || rise_hi < 0) ? NOT_SETTLED : rise_hi - rise_lo);
+		report(c->name, "overshoot_pct", peak * 100);
+	} else {
+		report(c->name, "peak_deviation_pct", peak * 100);
+	}
+	report(c->name, "settling_time_s", settle);
+	report(c->name, "steady_state_error_rpm", fabs(c->to_rpm - final));
+	report(c->name, "iae_rpm_s", iae);
+}
+
+// host time of one Speed_Control_Step, a stand-in for the target's
+// ControllerCycles which needs the board. On x86 the cycles are time
+// stamp counter ticks, which run at the nominal clock.
+static void run_timing(void) {
+	const long n = 10000000;
+	struct timespec t0, t1;
+	volatile int32_t sink = 0;
+	PID_Type pid;
+	long k;
+#if defined(__x86_64__) || defined(__i386__)
+	unsigned long long c0, c1;
+#endif
+
+	Speed_Control_Init(&pid);
+	clock_gettime(CLOCK_MONOTONIC, &t0);
+#if defined(__x86_64__) || defined(__i386__)
+	c0 = __rdtsc();
+#endif
+	for (k = 0; k < n; k++) {
+		sink += Speed_Control_Step(&pid, 1200, 1000 + (int32_t)(k & 255));
+	}
+#if defined(__x86_64__) || defined(__i386__)
+	c1 = __rdtsc();
+#endif
+	clock_gettime(CLOCK_MONOTONIC, &t1);
+	report("control_step", "host_ns_per_iteration",
+	       ((t1.tv_sec - t0.tv_sec) * 1e9 + (t1.tv_nsec - t0.tv_nsec)) / n);
+#if defined(__x86_64__) || defined(__i386__)
+	report("control_step", "host_cycles_per_iteration", (double)(c1 - c0) / n);
+#endif
+}
+
+static void print_value(const char *name, double value) {
+	if (value == NOT_SETTLED) {
+		printf("%s,not_settled\n", name);
+	} else {
+		printf("%s,%.6g\n", name, value);
+	}
+}
+
+// compares the results with a baseline file, returns the number of failures
+static int check(const char *path) {
+	FILE *in = fopen(path, "r");
+	char line[256], bench[64], metric[64], value[64], key[130];
+	double limit;
+	int i, failures = 0;
+
+	if (in == NULL) {
+		perror(path);
+		return 1;
+	}
+	while (fgets(line, sizeof(line), in)) {
+		if (sscanf(line, "%63[^,],%63[^,],%63s", bench, metric, value) != 3) {
+			continue;
+		}
+		limit = (strcmp(value, "not_settled") == 0) ? NOT_SETTLED : atof(value);
+		snprintf(key, sizeof(key), "%s,%s", bench, metric);
+		for (i = 0; i < num_results; i++) {
+			if (strcmp(results[i].name, key) == 0) break;
+		}
+		if (i == num_results) {
+			fprintf(stderr, "MISSING %s\n", key);
+			failures++;
+		} else if (results[i].value == NOT_SETTLED) {
+			fprintf(stderr, "FAIL %s: not settled\n", key);
+			failures++;
+		} else if (results[i].value > limit) {
+			fprintf(stderr, "FAIL %s: %g > %g\n", key, results[i].value, limit);
+			failures++;
+		}
+	}
+	fclose(in);
+	return failures;
+}
+
+int main(int argc, char **argv) {
+	const char *baseline = NULL;
+	double margin = -1;
+	unsigned i;
+	int failures = 0;
+
+	if (argc == 3 && strcmp(argv[1], "-c") == 0) {
+		baseline = argv[2];
+	} else if (argc == 3 && strcmp(argv[1], "-w") == 0) {
+		margin = atof(argv[2]) / 100;
+	} else if (argc != 1) {
+		fprintf(stderr, "usage: %s [-c baseline.csv | -w margin_pct]\n", argv[0]);
+		return 2;
+	}
+
+	for (i = 0; i < NUM_CASES; i++) {
+		run_case(&cases[i]);
+	}
+	run_timing();
+
+	for (i = 0; i < (unsigned)num_results; i++) {
+		// a baseline leaves room for noise, including on metrics that are 0.
+		// Host timing varies between machines, so it gets at least 3x.
+		double m = (strncmp(results[i].name, "control_step", 12) == 0 && margin < 2) ? 2 : margin;
+		double v = (margin >= 0) ? results[i].value * (1 + m) + 0.001 : results[i].value;
+		print_value(results[i].name, v);
+	}
+	if (baseline != NULL) {
+		failures = check(baseline);
+		fprintf(stderr, "%d regression(s)\n", failures);
+	}
+	return failures ? 1 : 0;
+}
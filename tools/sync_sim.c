@@ -0,0 +1,166 @@
+// sync_sim.c
+// Host tool, not part of the Keil project.
+// Shows why ADC_PWM_SYNC needs a much shorter moving average than
+// Timer0A sampling. The motor model runs open loop at a fixed duty and
+// is sampled two ways:
+//   timer0a  10 kHz conversions, 100 per PWM period, the average read at
+//            every 1 kHz control release
+//   sync     one conversion per PWM period in the middle of the off-time,
+//            where PWM_Sync_Compare puts comparator B, read after each
+// For every window of 1 to 128 samples the spread of the average seen by
+// the controller is measured, relative to its mean since the two modes
+// see different voltages (the whole PWM waveform against the back-EMF).
+// The codes go through the firmware's Sample_to_Millivolts.
+//
+// Build:  gcc -O2 -I. -o sync_sim tools/sync_sim.c tools/motor_model.c
+//             Sample_Process.c Filter.c Observer.c Voltage2RPM.c -lm
+//         Add -DADC_12BIT=1 for 12-bit conversions.
+// Usage:  sync_sim [noise_mV] > report.csv
+//
+// noise_mV is the rms noise at the ADC input, default 20. The report has
+// CSV lines "mode,duty,window,window_ms,mean_mv,std_mv,rel_std_pct",
+// then "mode,duty,window_needed": the shortest window whose rel_std_pct
+// is no worse than timer0a with its 128-sample window. window_ms is the
+// time a window spans, a sync sample being a whole PWM period. The exit
+// status is 1 if sync needs more than an eighth of that at any duty.
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <math.h>
+#include "motor_model.h"
+#include "Sample_Process.h"
+
+#define PWM_CLOCK	250000  // PWM counts per second
+#define PWM_PERIOD	2500    // 100 Hz
+#define STEP_COUNTS	5       // PWM counts per integration step (20 us)
+#define TIMER_COUNTS	25      // PWM counts per Timer0A conversion (10 kHz)
+#define TIMER_PHASE	10      // PWM count of the first Timer0A conversion in a period
+#define CONTROL_SAMPLES	10      // Timer0A conversions per control release
+#define SETTLE_S	3.0
+#define MEASURE_S	4.0
+#define MAX_WINDOW	128
+#define NUM_WINDOWS	8       // 1, 2, 4, ... MAX_WINDOW
+#define MAX_READS	4096
+
+enum { MODE_TIMER0A, MODE_SYNC, NUM_MODES };
+static const char *mode_names[NUM_MODES] = {"timer0a", "sync"};
+static const uint32_t duties[] = {700, 1200, 1700, 2200};
+#define NUM_DUTIES	(sizeof(duties) / sizeof(duties[0]))
+
+typedef struct {
+	double mean, std;
+} Spread;
+
+// Timer0A and the PWM both divide the bus clock, so the conversions
+// keep the same phases in every PWM period
+static int Timer_Due(uint32_t step) {
+	return (step * STEP_COUNTS) % TIMER_COUNTS == TIMER_PHASE;
+}
+
+// runs one mode at one duty and fills the spread of the average for
+// every window
+static void Run(int mode, uint32_t duty, double noise, Spread *spread) {
+	static double reads[NUM_WINDOWS][MAX_READS];
+	int32_t history[MAX_WINDOW] = {0};
+	uint32_t pos = 0, count = 0, n = 0, step, sync_step, w, i;
+	const double dt = (double)STEP_COUNTS / PWM_CLOCK;
+	double t = 0;
+	Motor_Model m;
+
+	Motor_Init(&m);
+	m.sense_noise = noise;
+	sync_step = (PWM_PERIOD - duty) / 2 / STEP_COUNTS; // middle of the off-time
+	while (t < SETTLE_S + MEASURE_S) {
+		for (step = 0; step < PWM_PERIOD / STEP_COUNTS; step++) {
+			int on = Motor_PWM_Output(step * STEP_COUNTS, duty, PWM_PERIOD);
+			int sample, read;
+
+			Motor_Step(&m, on, dt);
+			t += dt;
+			if (mode == MODE_SYNC) {
+				sample = (step == sync_step);
+				read = sample;
+			} else {
+				sample = Timer_Due(step);
+				read = sample && (count + 1) % CONTROL_SAMPLES == 0;
+			}
+			if (!sample) {
+				continue;
+			}
+			history[pos] = Sample_to_Millivolts(Motor_ADC_Sample(&m, on, ADC_12BIT ? 12 : 8));
+			pos = (pos + 1) % MAX_WINDOW;
+			count++;
+			if (read && t >= SETTLE_S && n < MAX_READS) {
+				for (w = 0; w < NUM_WINDOWS; w++) {
+					int32_t sum = 0;
+					for (i = 1; i <= (1u << w); i++) {
+						sum += history[(pos + MAX_WINDOW - i) % MAX_WINDOW];
+					}
+					reads[w][n] = (double)sum / (1u << w);
+				}
+				n++;
+			}
+		}
+	}
+
+	for (w = 0; w < NUM_WINDOWS; w++) {
+		double sum = 0, sq = 0;
+		for (i = 0; i < n; i++) {
+			sum += reads[w][i];
+		}
+		spread[w].mean = sum / n;
+		for (i = 0; i < n; i++) {
+			sq += (reads[w][i] - spread[w].mean) * (reads[w][i] - spread[w].mean);
+		}
+		spread[w].std = sqrt(sq / n);
+	}
+}
+
+static double Relative(const Spread *s) {
+	return (s->mean != 0) ? 100 * s->std / fabs(s->mean) : INFINITY;
+}
+
+int main(int argc, char **argv) {
+	static Spread spread[NUM_MODES][NUM_DUTIES][NUM_WINDOWS];
+	double noise = 0.020;
+	uint32_t d, w, needed[NUM_MODES][NUM_DUTIES];
+	int mode, fail = 0;
+
+	if (argc > 1) {
+		noise = atof(argv[1]) / 1000;
+	}
+	printf("mode,duty,window,window_ms,mean_mv,std_mv,rel_std_pct\n");
+	for (mode = 0; mode < NUM_MODES; mode++) {
+		for (d = 0; d < NUM_DUTIES; d++) {
+			Run(mode, duties[d], noise, spread[mode][d]);
+			for (w = 0; w < NUM_WINDOWS; w++) {
+				double ms = (1u << w) * ((mode == MODE_SYNC) ? 1000.0 * PWM_PERIOD / PWM_CLOCK
+				                                             : 1000.0 * TIMER_COUNTS / PWM_CLOCK);
+				printf("%s,%u,%u,%.1f,%.1f,%.2f,%.3f\n", mode_names[mode], duties[d], 1u << w, ms,
+				       spread[mode][d][w].mean, spread[mode][d][w].std, Relative(&spread[mode][d][w]));
+			}
+		}
+	}
+
+	printf("mode,duty,window_needed\n");
+	for (d = 0; d < NUM_DUTIES; d++) {
+		double target = Relative(&spread[MODE_TIMER0A][d][NUM_WINDOWS - 1]);
+		for (mode = 0; mode < NUM_MODES; mode++) {
+			needed[mode][d] = 0;
+			for (w = 0; w < NUM_WINDOWS && needed[mode][d] == 0; w++) {
+				if (Relative(&spread[mode][d][w]) <= target) {
+					needed[mode][d] = 1u << w;
+				}
+			}
+			printf("%s,%u,%u\n", mode_names[mode], duties[d], needed[mode][d]);
+		}
+		if (needed[MODE_SYNC][d] == 0 || needed[MODE_SYNC][d] > MAX_WINDOW / 8) {
+			fail = 1;
+		}
+	}
+	if (fail) {
+		fprintf(stderr, "sync sampling needs more than %u samples of averaging\n", MAX_WINDOW / 8);
+	}
+	return fail;
+}
@@ -0,0 +1,124 @@
+// tick_bench.c
+// Host tool, not part of the Keil project.
+// Cost of one scheduler tick for sleeping threads as a function of the
+// thread count: the old walk that decrements every Sleep counter,
+// against the delta queue in Delta_Queue.c that touches only the head.
+// Every thread sleeps. In the "long" case none wakes during the run, so
+// only the tick itself is timed. In the "periodic" case a thread that
+// wakes goes back to sleep at once for a pseudo-random 1..PERIOD ticks,
+// so the time also has the sorted insert that OS_Sleep does, which
+// walks the queue and grows with the thread count.
+//
+// Build:  gcc -O2 -I. -o tick_bench tools/tick_bench.c Delta_Queue.c
+// Usage:  tick_bench > report.csv
+//
+// The report has CSV lines
+// "threads,linear_long_ns,delta_long_ns,linear_periodic_ns,delta_periodic_ns,wakeups",
+// times are per tick and wakeups is the periodic total, which must be
+// the same for both methods or the exit status is 1.
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stddef.h>
+#include <time.h>
+#include "Delta_Queue.h"
+
+#define MAX_THREADS	128
+#define PERIOD	100           // longest sleep of the periodic case
+#define LONG_SLEEP	(2 * TICKS) // outlasts the run
+#define TICKS	200000
+
+typedef struct {
+	uint32_t Sleep;
+	DQ_Node SleepNode;
+	uint32_t seed;      // each thread draws its own sleep times
+} Thread;
+
+static Thread threads[MAX_THREADS];
+static DeltaQueue SleepQueue;
+
+static uint32_t Next_Sleep(Thread *t, uint32_t max) {
+	t->seed = t->seed * 1664525 + 1013904223;
+	return 1 + (t->seed >> 16) % max;
+}
+
+static double Now_ns(void) {
+	struct timespec t;
+	clock_gettime(CLOCK_MONOTONIC, &t);
+	return t.tv_sec * 1e9 + t.tv_nsec;
+}
+
+// the loop Scheduler used before the delta queue
+static unsigned long Linear(uint32_t n, uint32_t max, double *ns) {
+	unsigned long wakeups = 0;
+	uint32_t i, k;
+	double t0;
+
+	for (i = 0; i < n; i++) {
+		threads[i].seed = i;
+		threads[i].Sleep = Next_Sleep(&threads[i], max);
+	}
+	t0 = Now_ns();
+	for (k = 0; k < TICKS; k++) {
+		for (i = 0; i < n; i++) {
+			if (threads[i].Sleep) {
+				threads[i].Sleep--;
+				if (threads[i].Sleep == 0) {
+					wakeups++;
+					threads[i].Sleep = Next_Sleep(&threads[i], max);
+				}
+			}
+		}
+	}
+	*ns = (Now_ns() - t0) / TICKS;
+	return wakeups;
+}
+
+static unsigned long Delta(uint32_t n, uint32_t max, double *ns) {
+	unsigned long wakeups = 0;
+	uint32_t i, k;
+	DQ_Node *node;
+	Thread *pt;
+	double t0;
+
+	DeltaQueue_Init(&SleepQueue);
+	for (i = 0; i < n; i++) {
+		threads[i].seed = i;
+		DeltaQueue_Insert(&SleepQueue, &threads[i].SleepNode, Next_Sleep(&threads[i], max));
+	}
+	t0 = Now_ns();
+	for (k = 0; k < TICKS; k++) {
+		DeltaQueue_Tick(&SleepQueue);
+		while ((node = DeltaQueue_Expired(&SleepQueue)) != 0) {
+			pt = (Thread *)((char *)node - offsetof(Thread, SleepNode));
+			wakeups++;
+			DeltaQueue_Insert(&SleepQueue, &pt->SleepNode, Next_Sleep(pt, max));
+		}
+	}
+	*ns = (Now_ns() - t0) / TICKS;
+	return wakeups;
+}
+
+int main(void) {
+	static const uint32_t counts[] = {4, 8, 16, 32, 64, 128};
+	double linear_long, delta_long, linear_periodic, delta_periodic;
+	unsigned long linear_wakeups, delta_wakeups;
+	int fail = 0;
+	uint32_t c;
+
+	printf("threads,linear_long_ns,delta_long_ns,linear_periodic_ns,delta_periodic_ns,wakeups\n");
+	for (c = 0; c < sizeof(counts) / sizeof(counts[0]); c++) {
+		Linear(counts[c], LONG_SLEEP, &linear_long);
+		Delta(counts[c], LONG_SLEEP, &delta_long);
+		linear_wakeups = Linear(counts[c], PERIOD, &linear_periodic);
+		delta_wakeups = Delta(counts[c], PERIOD, &delta_periodic);
+		if (linear_wakeups != delta_wakeups) {
+			fprintf(stderr, "threads %u: %lu wakeups linear, %lu delta\n",
+				counts[c], linear_wakeups, delta_wakeups);
+			fail = 1;
+		}
+		printf("%u,%.1f,%.1f,%.1f,%.1f,%lu\n", counts[c], linear_long, delta_long,
+			linear_periodic, delta_periodic, linear_wakeups);
+	}
+	return fail;
+}